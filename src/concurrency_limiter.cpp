@@ -0,0 +1,112 @@
+/**
+ * @file concurrency_limiter.cpp
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "concurrency_limiter.h"
+#include <algorithm>
+
+#undef max
+#undef min
+
+
+namespace hackernewscmd {
+	const double ConcurrencyLimiter::kLatencyTolerance = 2.0;
+	const double ConcurrencyLimiter::kSmoothing = 0.2;
+	const double ConcurrencyLimiter::kDecreaseFactor = 0.75;
+
+	ConcurrencyLimiter::Permit::Permit(ConcurrencyLimiter& limiter) :
+		mLimiter(&limiter),
+		mStart(Clock::now()),
+		mSucceeded(false) {}
+
+	ConcurrencyLimiter::Permit::Permit(Permit&& other) :
+		mLimiter(other.mLimiter),
+		mStart(other.mStart),
+		mSucceeded(other.mSucceeded) {
+		other.mLimiter = nullptr;
+	}
+
+	ConcurrencyLimiter::Permit::~Permit() {
+		if (mLimiter != nullptr) {
+			mLimiter->Release(Clock::now() - mStart, mSucceeded);
+		}
+	}
+
+	void ConcurrencyLimiter::Permit::Succeeded() {
+		mSucceeded = true;
+	}
+
+	ConcurrencyLimiter::ConcurrencyLimiter(unsigned initialLimit, unsigned minLimit, unsigned maxLimit) :
+		mMinLimit(minLimit),
+		mMaxLimit(maxLimit),
+		mLimit(initialLimit),
+		mInFlight(0),
+		mSmoothedLatencyMs(0),
+		mMinLatencyMs(0),
+		mSamples(0),
+		mSamplesSinceDecrease(0) {}
+
+	ConcurrencyLimiter::Permit ConcurrencyLimiter::Acquire() {
+		std::unique_lock<std::mutex> lock(mMutex);
+		while (mInFlight >= static_cast<unsigned>(mLimit)) {
+			mCV.wait(lock);
+		}
+		++mInFlight;
+		return Permit(*this);
+	}
+
+	unsigned ConcurrencyLimiter::GetLimit() const {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return static_cast<unsigned>(mLimit);
+	}
+
+	unsigned ConcurrencyLimiter::GetInFlight() const {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mInFlight;
+	}
+
+	void ConcurrencyLimiter::Release(Clock::duration latency, bool succeeded) {
+		std::unique_lock<std::mutex> lock(mMutex);
+		auto wasSaturated = mInFlight >= static_cast<unsigned>(mLimit);
+		--mInFlight;
+		++mSamplesSinceDecrease;
+
+		if (succeeded) {
+			auto latencyMs = std::chrono::duration<double, std::milli>(latency).count();
+			mSmoothedLatencyMs = mSamples == 0 ? latencyMs : (1 - kSmoothing) * mSmoothedLatencyMs + kSmoothing * latencyMs;
+			// Start the minimum afresh now and then, so that a permanently
+			// slower link doesn't read as congestion forever
+			if (mSamples % kMinLatencyWindow == 0 || latencyMs < mMinLatencyMs) {
+				mMinLatencyMs = latencyMs;
+			}
+			++mSamples;
+		}
+
+		// Back off at most once per window of in flight requests, since the
+		// requests that were already out saw the same conditions
+		auto isCongested = !succeeded || mSmoothedLatencyMs > kLatencyTolerance * mMinLatencyMs;
+		if (isCongested && mSamplesSinceDecrease >= static_cast<unsigned>(mLimit)) {
+			mLimit = std::max(static_cast<double>(mMinLimit), mLimit * kDecreaseFactor);
+			mSamplesSinceDecrease = 0;
+		} else if (!isCongested && wasSaturated) {
+			mLimit = std::min(static_cast<double>(mMaxLimit), mLimit + 1 / mLimit);
+		}
+		lock.unlock();
+		mCV.notify_all();
+	}
+} // namespace hackernewscmd
\ No newline at end of file
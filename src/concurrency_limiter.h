@@ -0,0 +1,85 @@
+/**
+ * @file concurrency_limiter.h
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+
+namespace hackernewscmd {
+	/**
+	 * Adaptive cap on the number of requests in flight (AIMD).
+	 * While latency stays close to the lowest seen recently, the limit grows
+	 * by one for every limit's worth of requests that completed with the
+	 * limit saturated. When latency climbs or requests fail it is cut back
+	 * multiplicatively.
+	 */
+	class ConcurrencyLimiter {
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		/**
+		 * Held for the duration of a request. Dropping a permit without
+		 * marking it succeeded counts as a failure.
+		 */
+		class Permit {
+		public:
+			Permit(ConcurrencyLimiter&);
+			Permit(Permit&&);
+			~Permit();
+			Permit(const Permit&) = delete;
+			Permit& operator=(const Permit&) = delete;
+
+			void Succeeded();
+
+		private:
+			ConcurrencyLimiter* mLimiter;
+			Clock::time_point mStart;
+			bool mSucceeded;
+		};
+
+		ConcurrencyLimiter(unsigned, unsigned, unsigned);
+
+		// Blocks while the limit is saturated
+		Permit Acquire();
+		unsigned GetLimit() const;
+		unsigned GetInFlight() const;
+
+	private:
+		mutable std::mutex mMutex;
+		std::condition_variable mCV;
+		const unsigned mMinLimit;
+		const unsigned mMaxLimit;
+		double mLimit;
+		unsigned mInFlight;
+		double mSmoothedLatencyMs;
+		double mMinLatencyMs;
+		unsigned mSamples;
+		unsigned mSamplesSinceDecrease;
+
+		void Release(Clock::duration, bool);
+
+		static const unsigned kMinLatencyWindow = 100; // Samples before the minimum is forgotten
+		static const double kLatencyTolerance;
+		static const double kSmoothing;
+		static const double kDecreaseFactor;
+	}; // class ConcurrencyLimiter
+} // namespace hackernewscmd
\ No newline at end of file
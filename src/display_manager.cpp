@@ -18,18 +18,23 @@
 
 
 #include "display_manager.h"
-#include <WinInet.h>
+#include "encoding.h"
 
 
 namespace hackernewscmd {
-	DisplayManager::DisplayManager(const Interact& interact) :
+	DisplayManager::DisplayManager(const Interact& interact, const StringTable& hosts) :
 		mInteract(interact),
+		mHosts(hosts),
 		mCV(nullptr),
-		mStateManagerCV(nullptr),
-		mThreadData(nullptr),
+		mChannel(nullptr),
+		mStories(nullptr),
 		mCurrentlySelectedStory(nullptr),
-		mToBeSelectedStory(nullptr),
-		mShouldDisplayCommentCount(true) {};
+		mShouldDisplayCommentCount(true),
+		mPageBottom(0),
+		mPendingPage(),
+		mHasPendingPage(false),
+		mPendingSelection(nullptr),
+		mIsQuitting(false) {};
 
 	DisplayManager::~DisplayManager() {
 		if (mDisplayThread.joinable()) {
@@ -38,11 +43,11 @@ namespace hackernewscmd {
 		mLock.release();
 	}
 
-	void DisplayManager::Go(std::condition_variable& cv, std::mutex& m, DisplayThreadData& threadData, std::condition_variable& stateManagerCV) {
+	void DisplayManager::Go(std::condition_variable& cv, std::mutex& m, DisplayChannel& channel, StoryBuffer& stories) {
 		mCV = &cv;
+		mChannel = &channel;
+		mStories = &stories;
 		mLock = std::unique_lock<std::mutex>(m, std::defer_lock);
-		mThreadData = &threadData;
-		mStateManagerCV = &stateManagerCV;
 		mDisplayThread = std::thread(&DisplayManager::ThreadCallback, this);
 	}
 
@@ -53,101 +58,190 @@ namespace hackernewscmd {
 	}
 
 	void DisplayManager::ThreadCallback() {
-		using DTD = DisplayThreadData;
-
 		mLock.lock();
+		PublishCompletions(); // Whatever finished before the thread started
 		for (;;) {
-			bool shouldRedo = mThreadData->redo = false; // Since we're beginning the process
-
-			switch (mThreadData->action) {
-			case DTD::DisplayPage: {
-				mInteract.ClearScreen();
-				mDisplayData.clear();
-				auto data = mThreadData->GetActionData<DTD::DisplayPage, DTD::DisplayPageData>();
-				mCurrentlySelectedStory = &data->begin->first;
-				for (auto iter = data->begin; iter != data->end; ++iter) {
-					while (iter->second.loadStatus != StoryLoadStatus::Completed
-						&& iter->second.loadStatus != StoryLoadStatus::Failed) {
-						mCV->wait(mLock);
-					}
-					if (TryReadNewInstruction() && (shouldRedo = ShouldBreak()) == true) {
-						break;
-					}
-					auto& story = iter->first;
-					if (iter->second.loadStatus == StoryLoadStatus::Failed) {
-						mDisplayData[story.id] = mInteract.ShowFailedStory();
-					}
-					else if (mShouldDisplayCommentCount) {
-						mDisplayData[story.id] = mInteract.ShowStory(story.title, story.score, GetHostNameFromUrl(story.url), story.descendants);
-					} else {
-						mDisplayData[story.id] = mInteract.ShowStory(story.title, story.score, GetHostNameFromUrl(story.url));
-					}
-				}
-				if (shouldRedo) {
-					break;
-				}
-				mInteract.ShowPagePosition(data->currentPage, data->totalPages);
-				if (mToBeSelectedStory == nullptr) {
-					mToBeSelectedStory = mCurrentlySelectedStory;
-				}
-				mInteract.SwapSelectedStories(mDisplayData[mCurrentlySelectedStory->id], mDisplayData[mToBeSelectedStory->id]);
-				mCurrentlySelectedStory = mToBeSelectedStory;
-				break;
+			ReadCommands();
+			if (mIsQuitting) {
+				mLock.unlock();
+				return;
 			}
-			case DTD::SelectStory: {
-				auto data = mThreadData->GetActionData<DTD::SelectStory, Story>();
-				if (mDisplayData.count(data->id)) {
-					mInteract.SwapSelectedStories(mDisplayData[mCurrentlySelectedStory->id], mDisplayData[data->id]);
-					mCurrentlySelectedStory = data;
-				}
+			if (mHasPendingPage) {
+				// Copied, as reading commands while drawing can replace it
+				auto page = mPendingPage;
+				mHasPendingPage = false;
+				ShowPage(page);
+			} else if (mPendingSelection != nullptr) {
+				auto story = mPendingSelection;
+				mPendingSelection = nullptr;
+				SelectStory(story);
+				mInteract.Present();
+			} else {
+				WaitForWork();
+			}
+		}
+	}
+
+	void DisplayManager::ReadCommands() {
+		DisplayCommand command;
+		while (mChannel->commands.TryPop(command)) {
+			switch (command.action) {
+			case DisplayCommand::DisplayPage:
+				// The page starts out with its first story selected
+				mPendingPage = command.page;
+				mHasPendingPage = true;
+				mPendingSelection = nullptr;
+				break;
+			case DisplayCommand::SelectStory:
+				mPendingSelection = command.story;
+				break;
+			case DisplayCommand::Quit:
+				mIsQuitting = true;
 				break;
 			}
-			case DTD::Quit:
-				mLock.unlock();
+		}
+	}
+
+	void DisplayManager::ShowPage(const DisplayPageData& page) {
+		mInteract.ClearScreen();
+		mDisplayData.clear();
+		mSlots.assign(page.end - page.begin, StorySlot());
+		mCurrentlySelectedStory = &page.stories->GetStory(page.begin);
+		LayOutPage(page, page.begin);
+		mInteract.Present();
+
+		// Stories are painted in as they land, in whatever order, the page
+		// staying responsive to selections meanwhile
+		for (;;) {
+			ReadCommands();
+			if (mHasPendingPage || mIsQuitting) {
 				return;
-			default:
-				break;
 			}
-			if (!shouldRedo) {
-				mCV->wait(mLock);
-				mStateManagerCV->notify_all();
+			if (mPendingSelection != nullptr) {
+				SelectStory(mPendingSelection);
+				mPendingSelection = nullptr;
 			}
+			auto isPageDrawn = true;
+			for (auto index = page.begin; index != page.end; ++index) {
+				if (mSlots[index - page.begin].isDrawn) {
+					continue;
+				}
+				if (page.stories->IsSettled(index)) {
+					DrawSlot(page, index);
+				} else {
+					isPageDrawn = false;
+				}
+			}
+			mInteract.Present();
+			if (isPageDrawn) {
+				return;
+			}
+			WaitForWork();
 		}
 	}
 
-	bool DisplayManager::TryReadNewInstruction() {
-		auto ret = mThreadData->redo;
-		mThreadData->redo = false;
-		if (ret) {
-			if (mThreadData->action == DisplayThreadData::Action::SelectStory) {
-				mToBeSelectedStory = mThreadData->GetActionData<DisplayThreadData::Action::SelectStory, Story>();
+	void DisplayManager::LayOutPage(const DisplayPageData& page, std::size_t firstIndex) {
+		auto row = short(0);
+		if (firstIndex != page.begin) {
+			const auto& previous = mSlots[firstIndex - 1 - page.begin];
+			row = previous.top + previous.rows;
+			mInteract.ClearRows(row, mPageBottom);
+		}
+		mInteract.SetNextRow(row);
+		for (auto index = firstIndex; index != page.end; ++index) {
+			auto& slot = mSlots[index - page.begin];
+			slot.top = mInteract.GetNextRow();
+			slot.isDrawn = page.stories->IsSettled(index);
+			auto id = page.stories->GetId(index);
+			mDisplayData[id] = slot.isDrawn ? ShowStory(page, index) : mInteract.ShowStoryPlaceholder();
+			slot.rows = mInteract.GetNextRow() - slot.top;
+		}
+		mPageBottom = mInteract.GetNextRow();
+		mInteract.ShowPagePosition(page.currentPage, page.totalPages);
+		HighlightIfRedrawn(page, firstIndex, page.end);
+	}
+
+	void DisplayManager::DrawSlot(const DisplayPageData& page, std::size_t index) {
+		auto& slot = mSlots[index - page.begin];
+		mInteract.ClearRows(slot.top, slot.top + slot.rows - 1);
+		mInteract.SetNextRow(slot.top);
+		mDisplayData[page.stories->GetId(index)] = ShowStory(page, index);
+		slot.isDrawn = true;
+		if (mInteract.GetNextRow() - slot.top > slot.rows) {
+			// The title wrapped further than the slot allowed for, so the
+			// stories under it move down. What it was drawn over is cleared
+			// first.
+			mInteract.ClearRows(slot.top, mPageBottom);
+			mInteract.SetNextRow(slot.top);
+			mDisplayData[page.stories->GetId(index)] = ShowStory(page, index);
+			slot.rows = mInteract.GetNextRow() - slot.top;
+			if (index + 1 != page.end) {
+				LayOutPage(page, index + 1);
+			} else {
+				mInteract.ClearRows(mInteract.GetNextRow(), mPageBottom);
+				mPageBottom = mInteract.GetNextRow();
+				mInteract.ShowPagePosition(page.currentPage, page.totalPages);
 			}
-			mStateManagerCV->notify_all();
 		}
-		return ret;
+		HighlightIfRedrawn(page, index, index + 1);
 	}
 
-	bool DisplayManager::ShouldBreak() const {
-		auto action = mThreadData->action;
-		return action == DisplayThreadData::Action::DisplayPage
-			|| action == DisplayThreadData::Action::Quit;
+	StoryDisplayData DisplayManager::ShowStory(const DisplayPageData& page, std::size_t index) {
+		auto& story = page.stories->GetStory(index);
+		if (page.stories->GetLoadStatus(index) == StoryLoadStatus::Failed) {
+			return mInteract.ShowFailedStory();
+		}
+		if (mShouldDisplayCommentCount) {
+			return mInteract.ShowStory(Utf8ToWide(story.title.data, story.title.length), story.score, GetHostName(story), story.descendants);
+		}
+		return mInteract.ShowStory(Utf8ToWide(story.title.data, story.title.length), story.score, GetHostName(story));
 	}
 
-	std::wstring DisplayManager::GetHostNameFromUrl(const std::wstring& url)
-	{
-		URL_COMPONENTSW uc{};
-		uc.dwStructSize = sizeof(uc);
+	void DisplayManager::HighlightIfRedrawn(const DisplayPageData& page, std::size_t begin, std::size_t end) {
+		// Drawing over a slot takes the highlight off it
+		for (auto index = begin; index != end; ++index) {
+			if (page.stories->GetId(index) == mCurrentlySelectedStory->id) {
+				auto& displayData = mDisplayData[mCurrentlySelectedStory->id];
+				mInteract.SwapSelectedStories(displayData, displayData);
+				return;
+			}
+		}
+	}
 
-		const auto buffer_size = 4096;
-		wchar_t buff[buffer_size];
-		uc.lpszHostName = buff;
-		uc.dwHostNameLength = buffer_size;
+	void DisplayManager::SelectStory(const Story* story) {
+		if (mDisplayData.count(story->id)) {
+			mInteract.SwapSelectedStories(mDisplayData[mCurrentlySelectedStory->id], mDisplayData[story->id]);
+			mCurrentlySelectedStory = story;
+		}
+	}
 
-		if (!::InternetCrackUrlW(url.c_str(), url.length(), ICU_DECODE, &uc)) {
-			// Couldn't extract hostname
-			return url;
+	void DisplayManager::WaitForWork() {
+		// Either a producer sees the flag and wakes us under the mutex, which
+		// it can only get once we're waiting, or we see what it queued here
+		mChannel->isConsumerWaiting = true;
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (mChannel->completions.IsEmpty() && mChannel->commands.IsEmpty()) {
+			mCV->wait(mLock);
 		}
+		mChannel->isConsumerWaiting = false;
+		PublishCompletions();
+	}
 
-		return std::wstring(buff);
+	void DisplayManager::PublishCompletions() {
+		// With the display mutex held, so a refresh can't rearrange the
+		// buffer underneath
+		mChannel->completions.Drain([this](const StoryCompletion& completion) {
+			mStories->Publish(completion);
+		});
+	}
+
+	const std::wstring& DisplayManager::GetHostName(const Story& story) {
+		// Each host is widened once, the empty string standing for none
+		auto& hostName = mHostNames[story.host];
+		if (hostName.empty() && story.host != 0) {
+			auto host = mHosts.Lookup(story.host);
+			hostName = Utf8ToWide(host.data, host.length);
+		}
+		return hostName;
 	}
 } // namespace hackernewscmd
\ No newline at end of file
@@ -19,76 +19,116 @@
 
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
+#include <cstddef>
 #include <mutex>
+#include <string>
 #include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 #include "interact.h"
+#include "mpsc_queue.h"
+#include "ring_buffer.h"
 #include "story.h"
+#include "story_buffer.h"
+#include "string_arena.h"
 
 
 namespace hackernewscmd {
+	struct DisplayPageData {
+		const StoryBuffer* stories;
+		std::size_t begin, end; // Indices into the stories
+		unsigned currentPage, totalPages;
+	};
+
 	/**
-	 * Contains type of action, and the data needed to perform that operation
+	 * An instruction for the display thread, and the data it needs
 	 */
-	struct DisplayThreadData {
+	struct DisplayCommand {
 		enum Action { DisplayPage, SelectStory, Quit } action;
+		DisplayPageData page; // For DisplayPage
+		const Story* story; // For SelectStory
+	};
 
-		struct DisplayPageData {
-			std::vector<StoryAndStatus>::const_iterator begin;
-			std::vector<StoryAndStatus>::const_iterator end;
-			unsigned currentPage, totalPages;
-		};
-
-		template<Action A, typename T>
-		T* GetActionData();
-
-		template<>
-		DisplayPageData* GetActionData<DisplayPage>() {
-			return static_cast<DisplayPageData*>(mPtr);
-		}
-
-		template<>
-		Story* GetActionData<SelectStory>() {
-			return static_cast<Story*>(mPtr);
-		}
+	/**
+	 * Everything headed for the display thread: commands from the input
+	 * thread, and stories finished by the fetch threads, which the display
+	 * thread publishes into the buffer. Neither side blocks on the other;
+	 * the mutex is only taken to wake the display thread once it has said
+	 * it's going to sleep.
+	 */
+	struct DisplayChannel {
+		RingBuffer<DisplayCommand> commands;
+		MpscQueue<StoryCompletion> completions;
+		std::atomic<bool> isConsumerWaiting;
 
-		bool redo = true;
-		void SetPointer(void* ptr) { mPtr = ptr; }
+		DisplayChannel() : commands(kCommandCapacity), isConsumerWaiting(false) {};
 
-	private:
-		void* mPtr = nullptr;
-	}; // struct DisplayThreadData
+		// Far more than keys can be pressed in the time it takes to draw
+		static const std::size_t kCommandCapacity = 256;
+	};
 
 	/**
 	 * Manages display operations.
-	 * Consists of a thread that listens on a condition variable.
+	 * Consists of a thread that sleeps on a condition variable until there
+	 * are commands or finished stories in its channel. Queued commands are
+	 * folded together: a page display supersedes whatever came before it,
+	 * and only the latest selection counts.
+	 * A page comes up at once, with a placeholder in a slot for each story
+	 * still loading, and each story is painted into its slot as it lands.
 	 */
 	class DisplayManager {
 	public:
-		DisplayManager(const Interact&);
+		// Hosts are looked up in the table the fetcher interned them in
+		DisplayManager(const Interact&, const StringTable&);
 		~DisplayManager();
 
-		void Go(std::condition_variable&, std::mutex&, DisplayThreadData&, std::condition_variable&);
+		void Go(std::condition_variable&, std::mutex&, DisplayChannel&, StoryBuffer&);
 		void Wait();
 
 	private:
 		const Interact& mInteract;
+		const StringTable& mHosts;
+		std::unordered_map<StringTable::Id, std::wstring> mHostNames; // Widened, by host id
 		std::condition_variable *mCV;
-		std::condition_variable *mStateManagerCV;
 		std::unique_lock<std::mutex> mLock;
 		std::thread mDisplayThread;
-		DisplayThreadData *mThreadData;
+		DisplayChannel *mChannel;
+		StoryBuffer *mStories;
 		std::unordered_map<StoryId, StoryDisplayData> mDisplayData;
 		const Story *mCurrentlySelectedStory;
-		const Story *mToBeSelectedStory;
 		const bool mShouldDisplayCommentCount;
 
+		// Where each story of the page shown is drawn, by index in the page
+		struct StorySlot {
+			short top, rows;
+			bool isDrawn; // Or held by a placeholder
+		};
+		std::vector<StorySlot> mSlots;
+		short mPageBottom; // The footer's row
+
+		// What's left to do, after folding the commands read so far
+		DisplayPageData mPendingPage;
+		bool mHasPendingPage;
+		const Story *mPendingSelection;
+		bool mIsQuitting;
+
 		void ThreadCallback();
-		bool TryReadNewInstruction();
-		bool ShouldBreak() const;
-		static std::wstring GetHostNameFromUrl(const std::wstring&);
+		void ReadCommands();
+		void ShowPage(const DisplayPageData&);
+		// Lays the page out again from the story at the index down
+		void LayOutPage(const DisplayPageData&, std::size_t);
+		// Paints a story that has landed over its placeholder
+		void DrawSlot(const DisplayPageData&, std::size_t);
+		StoryDisplayData ShowStory(const DisplayPageData&, std::size_t);
+		void HighlightIfRedrawn(const DisplayPageData&, std::size_t, std::size_t);
+		void SelectStory(const Story*);
+		// Sleeps until there are commands or finished stories, and publishes
+		// the stories
+		void WaitForWork();
+		void PublishCompletions();
+		const std::wstring& GetHostName(const Story&);
 	}; // class DisplayManager
 } // namespace hackernewscmd
\ No newline at end of file
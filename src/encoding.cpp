@@ -0,0 +1,38 @@
+/**
+ * @file encoding.cpp
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "encoding.h"
+#include <Windows.h>
+
+
+namespace hackernewscmd {
+	std::wstring Utf8ToWide(const std::string& str) {
+		return Utf8ToWide(str.data(), str.length());
+	}
+
+	std::wstring Utf8ToWide(const char* str, std::size_t size) {
+		if (size == 0) {
+			return std::wstring();
+		}
+		auto length = ::MultiByteToWideChar(CP_UTF8, 0, str, size, NULL, 0);
+		std::wstring result(length, L'\0');
+		::MultiByteToWideChar(CP_UTF8, 0, str, size, &result[0], length);
+		return result;
+	}
+} // namespace hackernewscmd
\ No newline at end of file
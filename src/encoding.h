@@ -0,0 +1,29 @@
+/**
+ * @file encoding.h
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+
+namespace hackernewscmd {
+	std::wstring Utf8ToWide(const std::string&);
+	std::wstring Utf8ToWide(const char*, std::size_t);
+} // namespace hackernewscmd
\ No newline at end of file
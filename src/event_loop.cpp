@@ -0,0 +1,288 @@
+/**
+ * @file event_loop.cpp
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "event_loop.h"
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace hackernewscmd {
+	EventLoop::EventLoop(const Endpoint& endpoint) :
+		mEndpoint(endpoint),
+		mCompletionPort(NULL),
+		mInternetHandle(NULL),
+		mConnectHandle(NULL),
+		mRequestCount(0),
+		mConnectionCount(0) {
+		if ((mCompletionPort = ::CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1)) == NULL) {
+			throw std::runtime_error("Couldn't create completion port");
+		}
+		// WinINet queues requests beyond the bound, the fetcher decides how
+		// many it hands over at once
+		LimitConnectionsPerServer();
+		if ((mInternetHandle = ::InternetOpenA("hncmd", INTERNET_OPEN_TYPE_PRECONFIG, NULL, NULL, INTERNET_FLAG_ASYNC)) == NULL) {
+			::CloseHandle(mCompletionPort);
+			throw std::runtime_error("Couldn't get internet handle");
+		}
+		unsigned long timeout = kAttemptTimeoutMs;
+		::InternetSetOptionA(mInternetHandle, INTERNET_OPTION_CONNECT_TIMEOUT, &timeout, sizeof(timeout));
+		::InternetSetOptionA(mInternetHandle, INTERNET_OPTION_SEND_TIMEOUT, &timeout, sizeof(timeout));
+		::InternetSetOptionA(mInternetHandle, INTERNET_OPTION_RECEIVE_TIMEOUT, &timeout, sizeof(timeout));
+		::InternetSetStatusCallbackA(mInternetHandle, InternetStatusCallback);
+		// Completes at once, connections are only made for requests
+		if ((mConnectHandle = ::InternetConnectA(mInternetHandle, mEndpoint.host.c_str(), mEndpoint.port,
+			NULL, NULL, INTERNET_SERVICE_HTTP, 0, 0)) == NULL) {
+			::InternetCloseHandle(mInternetHandle);
+			::CloseHandle(mCompletionPort);
+			throw std::runtime_error("Couldn't connect to " + mEndpoint.host);
+		}
+		mThread = std::thread(&EventLoop::Run, this);
+	}
+
+	EventLoop::~EventLoop() {
+		Stop();
+		// Submissions that arrived after the loop stopped
+		DWORD bytes = 0;
+		ULONG_PTR key = 0;
+		LPOVERLAPPED overlapped = NULL;
+		while (::GetQueuedCompletionStatus(mCompletionPort, &bytes, &key, &overlapped, 0)) {
+			if (key == kSubmitKey) {
+				delete reinterpret_cast<Operation*>(overlapped);
+			}
+		}
+		::InternetCloseHandle(mConnectHandle);
+		::InternetCloseHandle(mInternetHandle);
+		::CloseHandle(mCompletionPort);
+	}
+
+	void EventLoop::Submit(const std::string& path, const Validators& validators, Clock::duration delay, FetchCompletion completion) {
+		auto operation = new Operation();
+		operation->loop = this;
+		operation->path = path;
+		operation->headers = validators.ToRequestHeaders();
+		operation->completion = std::move(completion);
+		operation->due = Clock::now() + delay;
+		operation->handle = NULL;
+		operation->state = State::Sending;
+		operation->length = 0;
+		operation->bytesRead = 0;
+		if (!::PostQueuedCompletionStatus(mCompletionPort, 0, kSubmitKey, reinterpret_cast<LPOVERLAPPED>(operation))) {
+			delete operation;
+			throw std::runtime_error("Couldn't queue " + path);
+		}
+	}
+
+	void EventLoop::Stop() {
+		if (mThread.joinable()) {
+			::PostQueuedCompletionStatus(mCompletionPort, 0, kQuitKey, NULL);
+			mThread.join();
+		}
+	}
+
+	ConnectionStats EventLoop::GetConnectionStats() const {
+		return { mRequestCount.load(), mConnectionCount.load() };
+	}
+
+	void EventLoop::Run() {
+		bool isQuitting = false;
+		// Once quitting, the loop lingers until WinINet is done with every
+		// operation's memory
+		while (!isQuitting || !mOperations.empty()) {
+			DWORD bytes = 0;
+			ULONG_PTR key = 0;
+			LPOVERLAPPED overlapped = NULL;
+			::GetQueuedCompletionStatus(mCompletionPort, &bytes, &key, &overlapped, isQuitting ? INFINITE : GetWaitTimeout());
+			auto operation = reinterpret_cast<Operation*>(overlapped);
+
+			switch (key) {
+			case kSubmitKey:
+				if (isQuitting) {
+					delete operation;
+					break;
+				}
+				mDelayed.push_back(operation);
+				std::push_heap(mDelayed.begin(), mDelayed.end(), IsLater);
+				break;
+			case kProgressKey:
+				// Bytes carries the error of the call that completed
+				if (mOperations.count(operation) != 0) {
+					Advance(operation, bytes);
+				}
+				break;
+			case kClosedKey:
+				mOperations.erase(operation);
+				delete operation;
+				break;
+			case kQuitKey:
+				isQuitting = true;
+				for (auto op : mOperations) {
+					if (op->handle != NULL) {
+						::InternetCloseHandle(op->handle);
+						op->handle = NULL;
+					}
+				}
+				for (auto op : mDelayed) {
+					delete op;
+				}
+				mDelayed.clear();
+				break;
+			default: // Timed out, some delayed operation is due
+				break;
+			}
+			if (!isQuitting) {
+				StartDueOperations();
+			}
+		}
+	}
+
+	DWORD EventLoop::GetWaitTimeout() const {
+		if (mDelayed.empty()) {
+			return INFINITE;
+		}
+		auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(mDelayed.front()->due - Clock::now()).count();
+		return wait > 0 ? static_cast<DWORD>(wait) + 1 : 0;
+	}
+
+	void EventLoop::StartDueOperations() {
+		auto now = Clock::now();
+		while (!mDelayed.empty() && mDelayed.front()->due <= now) {
+			std::pop_heap(mDelayed.begin(), mDelayed.end(), IsLater);
+			auto operation = mDelayed.back();
+			mDelayed.pop_back();
+			Start(operation);
+		}
+	}
+
+	void EventLoop::Start(Operation* operation) {
+		const unsigned long flags = (mEndpoint.isSecure ? INTERNET_FLAG_SECURE : 0) | INTERNET_FLAG_KEEP_CONNECTION | INTERNET_FLAG_RELOAD;
+		if ((operation->handle = ::HttpOpenRequestA(mConnectHandle, "GET", operation->path.c_str(), NULL, NULL, NULL,
+			flags, reinterpret_cast<DWORD_PTR>(operation))) == NULL) {
+			auto completion = std::move(operation->completion);
+			delete operation;
+			completion(FetchResult::Failed, std::vector<char>(), Validators());
+			return;
+		}
+		mOperations.insert(operation);
+		++mRequestCount;
+		if (::HttpSendRequestA(operation->handle, operation->headers.c_str(), operation->headers.length(), NULL, 0)) {
+			Advance(operation, ERROR_SUCCESS);
+		} else if (::GetLastError() != ERROR_IO_PENDING) {
+			Finish(operation, FetchResult::Failed);
+		}
+	}
+
+	void EventLoop::Advance(Operation* operation, DWORD error) {
+		if (operation->handle == NULL) {
+			return; // Already finished
+		}
+		if (error != ERROR_SUCCESS) {
+			Finish(operation, FetchResult::Failed);
+			return;
+		}
+
+		if (operation->state == State::Sending) {
+			unsigned long status = 0, headerSize = sizeof(status);
+			::HttpQueryInfoA(operation->handle, HTTP_QUERY_STATUS_CODE | HTTP_QUERY_FLAG_NUMBER, &status, &headerSize, NULL);
+			if (status == 304) {
+				Finish(operation, FetchResult::NotModified);
+				return;
+			}
+			if (status != 200) {
+				Finish(operation, FetchResult::Failed);
+				return;
+			}
+			unsigned long contentLength = 0;
+			headerSize = sizeof(contentLength);
+			if (!::HttpQueryInfoA(operation->handle, HTTP_QUERY_CONTENT_LENGTH | HTTP_QUERY_FLAG_NUMBER, &contentLength, &headerSize, NULL)) {
+				contentLength = 0;
+			}
+			operation->body.resize(contentLength != 0 ? contentLength + 1 : kReadChunkSize);
+			operation->state = State::Reading;
+		} else if (operation->bytesRead == 0) {
+			Finish(operation, FetchResult::Modified);
+			return;
+		} else {
+			operation->length += operation->bytesRead;
+		}
+
+		// Keep reading for as long as data is already at hand
+		for (;;) {
+			auto& body = operation->body;
+			if (operation->length == body.size()) {
+				body.resize(body.size() + kReadChunkSize);
+			}
+			operation->bytesRead = 0;
+			if (!::InternetReadFile(operation->handle, body.data() + operation->length, body.size() - operation->length, &operation->bytesRead)) {
+				if (::GetLastError() != ERROR_IO_PENDING) {
+					Finish(operation, FetchResult::Failed);
+				}
+				return;
+			}
+			if (operation->bytesRead == 0) {
+				Finish(operation, FetchResult::Modified);
+				return;
+			}
+			operation->length += operation->bytesRead;
+		}
+	}
+
+	void EventLoop::Finish(Operation* operation, FetchResult result) {
+		Validators validators;
+		if (result == FetchResult::Modified) {
+			validators.etag = QueryHttpHeader(operation->handle, HTTP_QUERY_ETAG);
+			validators.lastModified = QueryHttpHeader(operation->handle, HTTP_QUERY_LAST_MODIFIED);
+			operation->body.resize(operation->length);
+		} else {
+			operation->body.clear();
+		}
+		auto completion = std::move(operation->completion);
+		auto body = std::move(operation->body);
+		// The operation itself goes once WinINet reports the handle closed
+		::InternetCloseHandle(operation->handle);
+		operation->handle = NULL;
+		completion(result, std::move(body), validators);
+	}
+
+	bool EventLoop::IsLater(const Operation* a, const Operation* b) {
+		return a->due > b->due;
+	}
+
+	void CALLBACK EventLoop::InternetStatusCallback(HINTERNET, DWORD_PTR context, DWORD status, void* statusInformation, DWORD) {
+		// Runs on a WinINet thread, so does no more than hand over to the loop
+		auto operation = reinterpret_cast<Operation*>(context);
+		if (operation == nullptr) {
+			return;
+		}
+		switch (status) {
+		case INTERNET_STATUS_CONNECTED_TO_SERVER:
+			++operation->loop->mConnectionCount;
+			break;
+		case INTERNET_STATUS_REQUEST_COMPLETE: {
+			auto result = static_cast<INTERNET_ASYNC_RESULT*>(statusInformation);
+			::PostQueuedCompletionStatus(operation->loop->mCompletionPort, result->dwError, kProgressKey, reinterpret_cast<LPOVERLAPPED>(operation));
+			break;
+		}
+		case INTERNET_STATUS_HANDLE_CLOSING:
+			::PostQueuedCompletionStatus(operation->loop->mCompletionPort, 0, kClosedKey, reinterpret_cast<LPOVERLAPPED>(operation));
+			break;
+		default:
+			break;
+		}
+	}
+} // namespace hackernewscmd
\ No newline at end of file
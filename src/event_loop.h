@@ -0,0 +1,100 @@
+/**
+ * @file event_loop.h
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <Windows.h>
+#include <Wininet.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "transport.h"
+
+
+namespace hackernewscmd {
+	/**
+	 * Fetches over asynchronous WinINet from a single thread, so that many
+	 * requests can be in flight without a thread apiece. WinINet's status
+	 * callback only forwards progress to an I/O completion port, every
+	 * request is advanced on the thread that waits on it. Completions are
+	 * called on the loop thread.
+	 */
+	class EventLoop : public FetchSession {
+	public:
+		EventLoop(const Endpoint&);
+		~EventLoop();
+		EventLoop(const EventLoop&) = delete;
+		EventLoop& operator=(const EventLoop&) = delete;
+
+		void Submit(const std::string&, const Validators&, Clock::duration, FetchCompletion) override;
+		// Joins the loop thread
+		void Stop() override;
+		ConnectionStats GetConnectionStats() const override;
+
+	private:
+		enum class State {
+			Sending,
+			Reading
+		};
+
+		struct Operation {
+			EventLoop* loop;
+			std::string path;
+			std::string headers;
+			FetchCompletion completion;
+			Clock::time_point due;
+			HINTERNET handle;
+			State state;
+			std::vector<char> body;
+			std::size_t length;
+			DWORD bytesRead; // Written by WinINet when a read completes
+		};
+
+		const Endpoint mEndpoint;
+		HANDLE mCompletionPort;
+		HINTERNET mInternetHandle;
+		HINTERNET mConnectHandle;
+		std::thread mThread;
+		// Owned by the loop thread
+		std::unordered_set<Operation*> mOperations;
+		std::vector<Operation*> mDelayed; // Heap, earliest due first
+		std::atomic<unsigned long> mRequestCount;
+		std::atomic<unsigned long> mConnectionCount;
+		static const ULONG_PTR kSubmitKey = 1;
+		static const ULONG_PTR kProgressKey = 2;
+		static const ULONG_PTR kClosedKey = 3;
+		static const ULONG_PTR kQuitKey = 4;
+		static const unsigned long kAttemptTimeoutMs = 5000;
+		static const std::size_t kReadChunkSize = 4096;
+
+		void Run();
+		DWORD GetWaitTimeout() const;
+		void StartDueOperations();
+		void Start(Operation*);
+		void Advance(Operation*, DWORD);
+		void Finish(Operation*, FetchResult);
+		static bool IsLater(const Operation*, const Operation*);
+		static void CALLBACK InternetStatusCallback(HINTERNET, DWORD_PTR, DWORD, void*, DWORD);
+	}; // class EventLoop
+} // namespace hackernewscmd
\ No newline at end of file
@@ -0,0 +1,105 @@
+/**
+ * @file event_stream_parser.cpp
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "event_stream_parser.h"
+#include <stdexcept>
+
+
+namespace hackernewscmd {
+	EventStreamParser::EventStreamParser(const std::function<void(const ServerSentEvent&)>& handler) :
+		mHandler(handler),
+		mIsAfterCarriageReturn(false),
+		mRetryMs(0) {}
+
+	void EventStreamParser::Parse(const char* data, std::size_t length) {
+		for (std::size_t i = 0; i < length; ++i) {
+			char c = data[i];
+			// Lines end in CR, LF or CRLF
+			if (c == '\n' && mIsAfterCarriageReturn) {
+				mIsAfterCarriageReturn = false;
+				continue;
+			}
+			mIsAfterCarriageReturn = c == '\r';
+			if (c == '\r' || c == '\n') {
+				ProcessLine();
+				mLine.clear();
+			} else if (mLine.size() == kMaxLineLength) {
+				throw std::runtime_error("Event stream line too long");
+			} else {
+				mLine.push_back(c);
+			}
+		}
+	}
+
+	const std::string& EventStreamParser::GetLastEventId() const {
+		return mLastEventId;
+	}
+
+	unsigned long EventStreamParser::GetRetryMs() const {
+		return mRetryMs;
+	}
+
+	void EventStreamParser::ProcessLine() {
+		if (mLine.empty()) {
+			DispatchEvent();
+			return;
+		}
+		if (mLine[0] == ':') {
+			return; // Comment
+		}
+
+		auto colon = mLine.find(':');
+		auto field = mLine.substr(0, colon);
+		std::string value;
+		if (colon != std::string::npos) {
+			auto valueStart = colon + 1;
+			if (valueStart < mLine.size() && mLine[valueStart] == ' ') {
+				++valueStart;
+			}
+			value = mLine.substr(valueStart);
+		}
+
+		if (field == "event") {
+			mEvent.type = value;
+		} else if (field == "data") {
+			mEvent.data += value;
+			mEvent.data.push_back('\n');
+		} else if (field == "id") {
+			if (value.find('\0') == std::string::npos) {
+				mLastEventId = value;
+			}
+		} else if (field == "retry") {
+			if (!value.empty() && value.size() <= 9 && value.find_first_not_of("0123456789") == std::string::npos) {
+				mRetryMs = std::stoul(value);
+			}
+		}
+	}
+
+	void EventStreamParser::DispatchEvent() {
+		if (!mEvent.data.empty()) {
+			mEvent.data.pop_back(); // The newline after the last data line
+			if (mEvent.type.empty()) {
+				mEvent.type = "message";
+			}
+			mEvent.id = mLastEventId;
+			mHandler(mEvent);
+		}
+		mEvent = ServerSentEvent();
+	}
+} // namespace hackernewscmd
\ No newline at end of file
@@ -0,0 +1,63 @@
+/**
+ * @file event_stream_parser.h
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+
+namespace hackernewscmd {
+	struct ServerSentEvent {
+		std::string type; // "message" unless the server named it
+		std::string data;
+		std::string id; // The last id the stream has seen, for resuming it
+	};
+
+	/**
+	 * Incremental parser for a text/event-stream body.
+	 * Bytes are pushed in as they arrive and every event is handed to the
+	 * handler once the blank line ending it has been read. Comments, and
+	 * events without data, are dropped.
+	 */
+	class EventStreamParser {
+	public:
+		EventStreamParser(const std::function<void(const ServerSentEvent&)>&);
+		EventStreamParser& operator=(const EventStreamParser&) = delete;
+
+		// Throws std::runtime_error on a line too long to be sensible
+		void Parse(const char*, std::size_t);
+		const std::string& GetLastEventId() const;
+		// The reconnection delay the server asked for, 0 when it hasn't
+		unsigned long GetRetryMs() const;
+
+	private:
+		const std::function<void(const ServerSentEvent&)> mHandler;
+		std::string mLine;
+		bool mIsAfterCarriageReturn;
+		ServerSentEvent mEvent;
+		std::string mLastEventId;
+		unsigned long mRetryMs;
+		static const std::size_t kMaxLineLength = 1 << 20;
+
+		void ProcessLine();
+		void DispatchEvent();
+	}; // class EventStreamParser
+} // namespace hackernewscmd
\ No newline at end of file
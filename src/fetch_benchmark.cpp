@@ -0,0 +1,92 @@
+/**
+ * @file fetch_benchmark.cpp
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "fetch_benchmark.h"
+#include <condition_variable>
+#include <mutex>
+#include <utility>
+
+
+namespace hackernewscmd {
+	FetchBenchmark::FetchBenchmark(Transport& transport) :
+		mTransport(transport) {}
+
+	void FetchBenchmark::Run(std::wostream& out) {
+		std::vector<StoryId> ids;
+		{
+			NewsFetcher fetcher(mTransport, nullptr);
+			fetcher.FetchTopStoryIds([&ids](StoryId id) {
+				ids.push_back(id);
+			});
+		}
+		out << L"top stories: " << ids.size() << std::endl;
+
+		{
+			NewsFetcher fetcher(mTransport, nullptr);
+			Report(out, L"thread pool", Measure(fetcher, ids));
+		}
+		{
+			auto eventLoop = mTransport.OpenFetchSession();
+			NewsFetcher fetcher(mTransport, nullptr, eventLoop.get());
+			Report(out, L"event loop", Measure(fetcher, ids));
+		}
+	}
+
+	FetchBenchmark::Result FetchBenchmark::Measure(NewsFetcher& fetcher, const std::vector<StoryId>& ids) {
+		std::mutex mutex;
+		std::condition_variable cv;
+		std::size_t settled = 0, failed = 0;
+		auto onSettled = [&](bool isFailed) {
+			std::lock_guard<std::mutex> lock(mutex);
+			++settled;
+			failed += isFailed ? 1 : 0;
+			cv.notify_all();
+		};
+
+		std::vector<std::pair<StoryId, size_t>> toBeLoaded;
+		for (std::size_t index = 0; index < ids.size(); ++index) {
+			toBeLoaded.push_back(std::make_pair(ids[index], index));
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		fetcher.FetchStories(new FetchThreadData(
+			std::move(toBeLoaded),
+			[&onSettled](Story, size_t) { onSettled(false); },
+			[&onSettled](size_t) { onSettled(true); },
+			[&onSettled](size_t) { onSettled(true); },
+			std::make_shared<StringArena>()));
+		std::unique_lock<std::mutex> lock(mutex);
+		cv.wait(lock, [&]() { return settled == ids.size(); });
+
+		Result result;
+		result.stories = ids.size();
+		result.failed = failed;
+		result.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+		return result;
+	}
+
+	void FetchBenchmark::Report(std::wostream& out, const std::wstring& engine, const Result& result) {
+		auto seconds = result.elapsed.count() / 1000.0;
+		out << engine << L": " << result.stories << L" stories in " << result.elapsed.count() << L" ms";
+		if (seconds > 0) {
+			out << L" (" << static_cast<unsigned long>(result.stories / seconds) << L" stories/s)";
+		}
+		out << L", " << result.failed << L" failed" << std::endl;
+	}
+} // namespace hackernewscmd
\ No newline at end of file
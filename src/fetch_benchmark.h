@@ -0,0 +1,59 @@
+/**
+ * @file fetch_benchmark.h
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "fetcher.h"
+#include "story.h"
+#include "transport.h"
+
+
+namespace hackernewscmd {
+	/**
+	 * Loads every story on the top stories list through each fetch engine in
+	 * turn, and reports how long each took. Meant to be pointed at a local
+	 * mirror of the API, so that the numbers measure the engine rather than
+	 * the internet, or at a replayed corpus. Both engines fetch through the
+	 * same transport, so that they're measured against the same latency. The
+	 * item cache is left out so that every story goes over the transport.
+	 */
+	class FetchBenchmark {
+	public:
+		FetchBenchmark(Transport&);
+
+		void Run(std::wostream&);
+
+	private:
+		struct Result {
+			std::size_t stories;
+			std::size_t failed;
+			std::chrono::milliseconds elapsed;
+		};
+
+		Transport& mTransport;
+
+		static Result Measure(NewsFetcher&, const std::vector<StoryId>&);
+		static void Report(std::wostream&, const std::wstring&, const Result&);
+	}; // class FetchBenchmark
+} // namespace hackernewscmd
\ No newline at end of file
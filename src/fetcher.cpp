@@ -18,24 +18,155 @@
 
 
 #include "fetcher.h"
+#include <algorithm>
+#include <ctime>
 #include <future>
 #include <memory>
+#include <random>
 #include <stdexcept>
+#include <thread>
 #include "rapidjson/document.h"
+#include "story_id_parser.h"
+#include "url_host.h"
+
+#undef min
 
 
 namespace hackernewscmd {
-	const std::string NewsFetcher::kBaseUrl = "https://hacker-news.firebaseio.com/v0";
+	static StringRef StoreStringMember(const rapidjson::Value& object, const char* name, StringArena& arena) {
+		auto member = object.FindMember(name);
+		if (member == object.MemberEnd() || !member->value.IsString()) {
+			return StringRef();
+		}
+		return arena.Store(member->value.GetString(), member->value.GetStringLength());
+	}
+
+	static StringTable::Id InternStringMember(const rapidjson::Value& object, const char* name, StringTable& table) {
+		auto member = object.FindMember(name);
+		if (member == object.MemberEnd() || !member->value.IsString()) {
+			return 0;
+		}
+		return table.Intern(member->value.GetString(), member->value.GetStringLength());
+	}
+
+	static const std::size_t kMaxHostLength = 255;
+
+	// Hosts are matched without regard to case
+	static StringTable::Id InternUrlHost(const StringRef& url, StringTable& hosts) {
+		const char* host;
+		std::size_t length;
+		if (!TryGetUrlHost(url.data, url.length, host, length) || length > kMaxHostLength) {
+			return 0;
+		}
+		char lowered[kMaxHostLength];
+		std::transform(host, host + length, lowered, [](char c) {
+			return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+		});
+		return hosts.Intern(lowered, length);
+	}
+
+	// A deleted or dead item comes back as null, or flagged as such, and no
+	// retry will bring it back
+	static bool IsGone(const rapidjson::Value& document) {
+		if (!document.IsObject()) {
+			return true;
+		}
+		for (auto flag : { "deleted", "dead" }) {
+			auto member = document.FindMember(flag);
+			if (member != document.MemberEnd() && member->value.IsTrue()) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// A truncated or error body can still be valid JSON, so check the shape
+	// before trusting it, and before storing any of it
+	static bool TryReadStory(const rapidjson::Value& document, StringArena& arena, StringTable& authors, StringTable& hosts, Story& story) {
+		if (!document.IsObject()) {
+			return false;
+		}
+		auto score = document.FindMember("score");
+		auto time = document.FindMember("time");
+		if (score == document.MemberEnd() || !score->value.IsUint()
+			|| time == document.MemberEnd() || !time->value.IsInt64()) {
+			return false;
+		}
+		story.title = StoreStringMember(document, "title", arena);
+		story.url = StoreStringMember(document, "url", arena);
+		story.host = InternUrlHost(story.url, hosts);
+		story.score = score->value.GetUint();
+		auto descendants = document.FindMember("descendants");
+		if (descendants != document.MemberEnd() && descendants->value.IsUint()) {
+			story.descendants = descendants->value.GetUint();
+		}
+		story.time = time->value.GetInt64();
+		story.by = InternStringMember(document, "by", authors);
+		return true;
+	}
+
+	FetchBatch::FetchBatch(NewsFetcher* nf, const FetchThreadData* ftd) :
+		fetcher(nf),
+		data(ftd),
+		remaining(ftd->ToBeLoaded.size()) {}
+
+	bool FetchHandle::IsDone() const {
+		return mBatch == nullptr || mBatch->remaining == 0;
+	}
+
+	void FetchHandle::Cancel() const {
+		if (mBatch != nullptr) {
+			mBatch->fetcher->Cancel(*mBatch);
+		}
+	}
+
+	const std::string NewsFetcher::kHost = "hacker-news.firebaseio.com";
+	const std::string NewsFetcher::kBasePath = "/v0";
 	const std::string NewsFetcher::kTopStories = "/topstories.json";
+	const NewsFetcher::Clock::duration NewsFetcher::kItemDeadline = std::chrono::seconds(20);
+	const NewsFetcher::Clock::duration NewsFetcher::kBackoffBase = std::chrono::milliseconds(100);
+	const NewsFetcher::Clock::duration NewsFetcher::kBackoffCap = std::chrono::seconds(2);
 
-	NewsFetcher::NewsFetcher() :
-		mInternetHandle(NULL),
+	NewsFetcher::NewsFetcher(Transport& transport, ItemCache* itemCache, FetchSession* eventLoop) :
+		mTransport(transport),
+		mItemCache(itemCache),
+		mEventLoop(eventLoop),
+		mEventLoopInFlight(0),
+		mLimiter(kInitialConcurrency, kMinConcurrency, kMaxConcurrency),
+		mThreadMaximum(kInitialConcurrency),
 		mThreadpool(NULL),
-		mThreadpoolCallbackEnvironment(NULL) {}
+		mThreadpoolCallbackEnvironment(NULL),
+		mCleanupGroup(NULL),
+		mHedgeTimer(NULL),
+		mNextSequence(0),
+		mCoalescedCount(0),
+		mRetryCount(0),
+		mHedgeCount(0),
+		mHedgeWinCount(0),
+		mAuthors(mInternedArena),
+		mHosts(mInternedArena) {}
 
 	NewsFetcher::~NewsFetcher() {
-		if (mInternetHandle != NULL && InternetCloseHandle(mInternetHandle) != TRUE) {
-			throw std::runtime_error("Could not close internet handle");
+		{
+			// Whatever hasn't started by now is abandoned, so the work items
+			// left in the pool return at once
+			std::lock_guard<std::mutex> lock(mPendingMutex);
+			mPending.clear();
+			mRequestsById.clear();
+		}
+		if (mEventLoop != nullptr) {
+			// Its completions call back into the fetcher
+			mEventLoop->Stop();
+		}
+		if (mHedgeTimer != NULL) {
+			::SetThreadpoolTimer(mHedgeTimer, NULL, 0, 0);
+			::WaitForThreadpoolTimerCallbacks(mHedgeTimer, TRUE);
+		}
+		if (mCleanupGroup != NULL) {
+			// Closes the timer too, and waits for stories and hedges still
+			// running
+			::CloseThreadpoolCleanupGroupMembers(mCleanupGroup, FALSE, NULL);
+			::CloseThreadpoolCleanupGroup(mCleanupGroup);
 		}
 		if (mThreadpool != NULL) {
 			CloseThreadpool(mThreadpool);
@@ -46,54 +177,105 @@ namespace hackernewscmd {
 		}
 	}
 
-	std::vector<StoryId> NewsFetcher::FetchTopStoryIds() {
-		auto topStoriesJson = FetchUrl(kBaseUrl + kTopStories);
-		rapidjson::GenericDocument<rapidjson::UTF16<>> document;
-		if (document.Parse(&topStoriesJson[0]).HasParseError() || !document.IsArray()) {
-			throw std::runtime_error("Error while parsing response JSON");
-		}
-		std::vector<StoryId> topStoryIds;
-		topStoryIds.reserve(document.Size());
-		for (long long i = 0; i < document.Size(); ++i) {
-			if (!document[i].IsNull()) {
-				topStoryIds.emplace_back(document[i].GetUint64());
-			}
+	void NewsFetcher::FetchTopStoryIds(const std::function<void(StoryId)>& onStoryId) {
+		StoryIdParser parser(onStoryId);
+		mTransport.FetchStreaming(kBasePath + kTopStories, [&parser](const char* data, std::size_t length) {
+			parser.Parse(data, length);
+		});
+		parser.Finish();
+	}
+
+	void NewsFetcher::FetchTopStoryIdsAsync(const std::function<void(std::vector<StoryId>)>& onList) {
+		auto td = new ListThreadData{ this, onList };
+		if (!::TrySubmitThreadpoolCallback(TopStoriesCallback, td, GetThreadpoolCallbackEnvironment())) {
+			delete td;
+			throw std::runtime_error("Couldn't queue top stories download");
 		}
-		return topStoryIds;
 	}
 
-	void NewsFetcher::FetchStories(const FetchThreadData* ftd) {
-		std::unique_ptr<const FetchThreadData> threadData(ftd);
-		PTP_CALLBACK_ENVIRON cbe = GetThreadpoolCallbackEnvironment();
-		PTP_CLEANUP_GROUP cug = ::CreateThreadpoolCleanupGroup();
-		::SetThreadpoolCallbackCleanupGroup(cbe, cug, NULL);
-		ThreadData* td = NULL;
-		PTP_WORK work = NULL;
+	StoryStorageStats NewsFetcher::GetStoryStorageStats() const {
+		return { mInternedArena.GetSize(), mAuthors.GetCount(), mHosts.GetCount() };
+	}
+
+	std::unique_ptr<TopStoriesSubscription> NewsFetcher::SubscribeTopStoryIds(const std::function<void(std::vector<StoryId>)>& onUpdate) {
+		return std::make_unique<TopStoriesSubscription>(mTransport, kBasePath + kTopStories, onUpdate);
+	}
+
+	FetchHandle NewsFetcher::FetchStories(const FetchThreadData* ftd) {
+		auto batch = std::make_shared<FetchBatch>(this, ftd);
+		PTP_CALLBACK_ENVIRON cbe = mEventLoop == nullptr ? GetThreadpoolCallbackEnvironment() : NULL;
 
-		for (const auto& item : threadData->ToBeLoaded) {
-			td = new ThreadData(this, item.first, item.second, &threadData->OnFetchComplete, &threadData->OnFetchFailed);
-			if ((work = ::CreateThreadpoolWork(ThreadCallback, td, cbe)) == NULL) {
-				threadData->OnFetchFailed(item.second);
+		for (const auto& item : batch->data->ToBeLoaded) {
+			auto request = Enqueue(batch, item.first, item.second);
+			if (request == nullptr || mEventLoop != nullptr) {
 				continue;
 			}
-			::SubmitThreadpoolWork(work);
+			// Each callback loads whichever queued story matters most when it
+			// gets a thread, not necessarily the one it was submitted for
+			if (!::TrySubmitThreadpoolCallback(ThreadCallback, this, cbe)) {
+				// Some story is left without a callback to load it, give up
+				// on this one unless another callback already has it
+				std::vector<Subscriber> subscribers;
+				{
+					std::lock_guard<std::mutex> lock(mPendingMutex);
+					auto iter = std::find(mPending.begin(), mPending.end(), request);
+					if (iter != mPending.end()) {
+						mPending.erase(iter);
+						mRequestsById.erase(request->storyId);
+						subscribers.swap(request->subscribers);
+					}
+				}
+				for (const auto& subscriber : subscribers) {
+					subscriber.batch->data->OnFetchFailed(subscriber.index);
+					--subscriber.batch->remaining;
+				}
+			}
+		}
+		if (mEventLoop != nullptr) {
+			PumpEventLoop();
 		}
-		::CloseThreadpoolCleanupGroupMembers(cug, FALSE, NULL);
+		return FetchHandle(batch);
 	}
 
-	HINTERNET NewsFetcher::GetInternetHandle() {
-		if (mInternetHandle == NULL) {
-			if (::InternetAttemptConnect(0) != ERROR_SUCCESS) {
-				throw std::runtime_error("Couldn't connect to internet");
-			}
-			if (::InternetCheckConnectionA(kBaseUrl.c_str(), FLAG_ICC_FORCE_CONNECTION, 0) != TRUE) {
-				throw std::runtime_error("Couldn't connect to " + kBaseUrl);
-			}
-			if ((mInternetHandle = ::InternetOpenA("hncmd", INTERNET_OPEN_TYPE_PRECONFIG, NULL, NULL, 0)) == NULL) {
-				throw std::runtime_error("Couldn't get internet handle");
+	void NewsFetcher::Reprioritise(const std::function<FetchPriority(std::size_t)>& getPriority) {
+		std::lock_guard<std::mutex> lock(mPendingMutex);
+		for (auto& request : mPending) {
+			// A shared request goes as fast as its most urgent subscriber
+			request->priority = FetchPriority::Background;
+			for (const auto& subscriber : request->subscribers) {
+				request->priority = std::min(request->priority, getPriority(subscriber.index));
 			}
 		}
-		return mInternetHandle;
+	}
+
+	ConnectionStats NewsFetcher::GetConnectionStats() const {
+		auto stats = mTransport.GetConnectionStats();
+		if (mEventLoop != nullptr) {
+			auto eventLoopStats = mEventLoop->GetConnectionStats();
+			stats.requests += eventLoopStats.requests;
+			stats.connections += eventLoopStats.connections;
+		}
+		return stats;
+	}
+
+	unsigned NewsFetcher::GetConcurrencyLimit() const {
+		return mLimiter.GetLimit();
+	}
+
+	unsigned NewsFetcher::GetRequestsInFlight() const {
+		return mLimiter.GetInFlight();
+	}
+
+	unsigned long NewsFetcher::GetCoalescedCount() const {
+		return mCoalescedCount;
+	}
+
+	RetryStats NewsFetcher::GetRetryStats() const {
+		RetryStats stats;
+		stats.retries = mRetryCount;
+		stats.hedges = mHedgeCount;
+		stats.hedgesWon = mHedgeWinCount;
+		return stats;
 	}
 
 	PTP_CALLBACK_ENVIRON NewsFetcher::GetThreadpoolCallbackEnvironment() {
@@ -101,79 +283,429 @@ namespace hackernewscmd {
 			if (mThreadpool == NULL && (mThreadpool = ::CreateThreadpool(NULL)) == NULL) {
 				throw std::runtime_error("Couldn't create thread pool");
 			}
-			::SetThreadpoolThreadMaximum(mThreadpool, kMaxThreads);
+			::SetThreadpoolThreadMaximum(mThreadpool, mThreadMaximum);
 			mThreadpoolCallbackEnvironment = new TP_CALLBACK_ENVIRON;
 			::InitializeThreadpoolEnvironment(mThreadpoolCallbackEnvironment);
 			::SetThreadpoolCallbackPool(mThreadpoolCallbackEnvironment, mThreadpool);
+			if ((mCleanupGroup = ::CreateThreadpoolCleanupGroup()) == NULL) {
+				throw std::runtime_error("Couldn't create cleanup group");
+			}
+			::SetThreadpoolCallbackCleanupGroup(mThreadpoolCallbackEnvironment, mCleanupGroup, NULL);
+			if ((mHedgeTimer = ::CreateThreadpoolTimer(HedgeTimerCallback, this, mThreadpoolCallbackEnvironment)) == NULL) {
+				throw std::runtime_error("Couldn't create hedge timer");
+			}
 		}
 		return mThreadpoolCallbackEnvironment;
 	}
 
-	std::vector<wchar_t> NewsFetcher::FetchUrl(const std::string& url) {
-		HINTERNET internetHandle = GetInternetHandle(), resultHandle;
-		if ((resultHandle = ::InternetOpenUrlA(internetHandle, url.c_str(), NULL, 0, INTERNET_FLAG_RELOAD, NULL)) == NULL) {
-			throw std::runtime_error("Couldn't fetch " + url);
+	bool NewsFetcher::FetchItem(const StoryId id, std::vector<char>& json, CachedItem& item) {
+		auto path = kBasePath + "/item/" + std::to_string(id) + ".json";
+		bool isFresh = false;
+		bool isCached = mItemCache != nullptr && mItemCache->TryGet(id, item, isFresh);
+		bool isModified = true;
+		if (!isFresh) {
+			if (!isCached) {
+				item.validators = Validators();
+			}
+			{
+				auto permit = mLimiter.Acquire();
+				auto start = Clock::now();
+				isModified = mTransport.FetchIfModified(path, item.validators, json);
+				mLatencyTracker.Add(Clock::now() - start);
+				permit.Succeeded();
+			}
+			ApplyConcurrencyLimit();
+		}
+		if (isFresh || !isModified) {
+			if (!isFresh) {
+				mItemCache->Revalidated(id, item);
+			}
+			json.assign(item.body.begin(), item.body.end());
+			json.push_back('\0'); // Terminator for in situ parsing
+			return false;
+		}
+		// Keep the pristine body, in situ parsing overwrites the buffer
+		item.body.assign(json.begin(), json.end());
+		json.push_back('\0');
+		return true;
+	}
+
+	std::shared_ptr<NewsFetcher::ItemRequest> NewsFetcher::Enqueue(const std::shared_ptr<FetchBatch>& batch, const StoryId id, const std::size_t index) {
+		std::lock_guard<std::mutex> lock(mPendingMutex);
+		auto existing = mRequestsById.find(id);
+		if (existing != mRequestsById.end()) {
+			// Already queued or loading, share its result
+			auto& request = existing->second;
+			request->subscribers.push_back(Subscriber{ batch, index });
+			request->priority = std::min(request->priority, batch->data->Priority);
+			++mCoalescedCount;
+			return nullptr;
+		}
+
+		auto request = std::make_shared<ItemRequest>(this, id);
+		request->subscribers.push_back(Subscriber{ batch, index });
+		request->priority = batch->data->Priority;
+		request->sequence = mNextSequence++;
+		request->arena = batch->data->Arena;
+		mRequestsById[id] = request;
+		mPending.push_back(request);
+		return request;
+	}
+
+	void NewsFetcher::Cancel(FetchBatch& batch) {
+		std::vector<std::size_t> cancelled;
+		{
+			std::lock_guard<std::mutex> lock(mPendingMutex);
+			for (auto& request : mPending) {
+				auto& subscribers = request->subscribers;
+				auto end = std::remove_if(subscribers.begin(), subscribers.end(), [&batch, &cancelled](const Subscriber& subscriber) {
+					if (subscriber.batch.get() != &batch) {
+						return false;
+					}
+					cancelled.push_back(subscriber.index);
+					return true;
+				});
+				subscribers.erase(end, subscribers.end());
+			}
+			// Requests that other batches still wait on stay queued
+			auto end = std::remove_if(mPending.begin(), mPending.end(), [this](const std::shared_ptr<ItemRequest>& request) {
+				if (!request->subscribers.empty()) {
+					return false;
+				}
+				mRequestsById.erase(request->storyId);
+				return true;
+			});
+			mPending.erase(end, mPending.end());
 		}
-		std::vector<wchar_t> resultVector;
-		unsigned long bytesRead = 0;
-		int wBytesRead = 0;
-		char buff[4096];
-		wchar_t wbuff[4096];
-		while (::InternetReadFile(resultHandle, buff, 4096, &bytesRead)
-			&& bytesRead != 0
-			&& (wBytesRead = ::MultiByteToWideChar(CP_UTF8, 0, buff, bytesRead, wbuff, 4096)) != 0) {
-			resultVector.insert(resultVector.end(), wbuff, wbuff + wBytesRead);
+		for (auto index : cancelled) {
+			batch.data->OnFetchCancelled(index);
+			--batch.remaining;
 		}
-		resultVector.push_back('\0');
-		::InternetCloseHandle(resultHandle);
-		return resultVector;
 	}
 
-	NewsFetcher::ThreadData::ThreadData(
-		NewsFetcher* nf,
-		const StoryId sid,
-		const std::size_t idx,
-		const std::function<void(Story, std::size_t)>* success,
-		const std::function<void(std::size_t)>* failure) :
-		fetcher(nf),
-		storyId(sid),
-		index(idx),
-		successCallback(success),
-		failureCallback(failure) {}
-
-	void CALLBACK NewsFetcher::ThreadCallback(PTP_CALLBACK_INSTANCE, void *context, PTP_WORK) {
-		std::unique_ptr<ThreadData> td(static_cast<ThreadData *>(context));
-		auto itemId = std::to_string(td->storyId);
-
-		auto retriesLeft = 3;
-		rapidjson::GenericDocument<rapidjson::UTF16<>> document;
-		while (retriesLeft--) {
-			std::vector<wchar_t> json;
+	std::shared_ptr<NewsFetcher::ItemRequest> NewsFetcher::PopNextRequest() {
+		std::lock_guard<std::mutex> lock(mPendingMutex);
+		if (mPending.empty()) {
+			return nullptr;
+		}
+		auto next = std::min_element(mPending.begin(), mPending.end(), [](const std::shared_ptr<ItemRequest>& a, const std::shared_ptr<ItemRequest>& b) {
+			return a->priority != b->priority ? a->priority < b->priority : a->sequence < b->sequence;
+		});
+		auto request = std::move(*next);
+		*next = std::move(mPending.back());
+		mPending.pop_back();
+		return request;
+	}
+
+	void NewsFetcher::ApplyConcurrencyLimit() {
+		// Keep the pool from spinning up threads that would only wait on the
+		// limiter
+		auto limit = mLimiter.GetLimit();
+		if (mThreadpool != NULL && mThreadMaximum.exchange(limit) != limit) {
+			::SetThreadpoolThreadMaximum(mThreadpool, limit);
+		}
+	}
+
+	std::vector<char> NewsFetcher::AcquireBuffer() {
+		std::lock_guard<std::mutex> lock(mBuffersMutex);
+		if (mBuffers.empty()) {
+			return std::vector<char>();
+		}
+		auto buffer = std::move(mBuffers.back());
+		mBuffers.pop_back();
+		return buffer;
+	}
+
+	void NewsFetcher::ReleaseBuffer(std::vector<char>&& buffer) {
+		std::lock_guard<std::mutex> lock(mBuffersMutex);
+		mBuffers.push_back(std::move(buffer));
+	}
+
+	bool NewsFetcher::TryLoadStory(ItemRequest& request, const unsigned attempts, Story& story) {
+		auto json = AcquireBuffer();
+		rapidjson::Document document;
+		CachedItem cachedItem;
+		bool shouldCache = false;
+		bool isLoaded = false;
+		auto deadline = request.start + kItemDeadline;
+
+		for (unsigned attempt = 0; attempt < attempts && !isLoaded && !request.isSettled; ++attempt) {
+			if (attempt != 0) {
+				auto delay = GetBackoffDelay(attempt);
+				if (Clock::now() + delay >= deadline) {
+					break;
+				}
+				++mRetryCount;
+				std::this_thread::sleep_for(delay);
+			}
 			try {
-				json = td->fetcher->FetchUrl(kBaseUrl + "/item/" + itemId + ".json");
+				shouldCache = FetchItem(request.storyId, json, cachedItem);
 			} catch (const std::runtime_error&) {
 				continue;
 			}
-			if (!document.Parse(&json[0]).HasParseError()) {
+			bool isParsed = !document.ParseInsitu(json.data()).HasParseError();
+			if (isParsed && IsGone(document)) {
 				break;
 			}
-			retriesLeft = 0;
+			isLoaded = isParsed && TryReadStory(document, *request.arena, mAuthors, mHosts, story);
+			if (!isLoaded && !shouldCache && mItemCache != nullptr) {
+				// Served from the cache, which would serve the same bytes
+				// to every retry
+				mItemCache->Evict(request.storyId);
+			}
+		}
+		// Strings have been copied out of the document, the buffer can be reused
+		ReleaseBuffer(std::move(json));
+		if (!isLoaded) {
+			return false;
+		}
+
+		story.id = request.storyId;
+		if (shouldCache && mItemCache != nullptr) {
+			cachedItem.fetchTime = std::time(nullptr);
+			cachedItem.storyTime = story.time;
+			mItemCache->Put(story.id, std::move(cachedItem));
+		}
+		return true;
+	}
+
+	void NewsFetcher::Register(const std::shared_ptr<ItemRequest>& request) {
+		std::lock_guard<std::mutex> lock(mInFlightMutex);
+		if (mInFlight.empty()) {
+			// Relative due time, in 100ns units
+			ULARGE_INTEGER due;
+			due.QuadPart = static_cast<ULONGLONG>(-static_cast<LONGLONG>(kHedgeScanIntervalMs) * 10000);
+			FILETIME dueTime;
+			dueTime.dwLowDateTime = due.LowPart;
+			dueTime.dwHighDateTime = due.HighPart;
+			::SetThreadpoolTimer(mHedgeTimer, &dueTime, kHedgeScanIntervalMs, 0);
+		}
+		mInFlight.push_back(request);
+	}
+
+	void NewsFetcher::Unregister(const ItemRequest& request) {
+		std::lock_guard<std::mutex> lock(mInFlightMutex);
+		auto iter = std::find_if(mInFlight.begin(), mInFlight.end(), [&request](const std::shared_ptr<ItemRequest>& r) {
+			return r.get() == &request;
+		});
+		if (iter != mInFlight.end()) {
+			mInFlight.erase(iter);
+		}
+		if (mInFlight.empty() && mHedgeTimer != NULL) {
+			::SetThreadpoolTimer(mHedgeTimer, NULL, 0, 0);
 		}
-		if (retriesLeft == -1) {
-			(*td->failureCallback)(td->index);
+	}
+
+	void NewsFetcher::Settle(ItemRequest& request, const bool isHedge, const Story* story) {
+		bool isLastAttempt = --request.attemptsOutstanding == 0;
+		if ((story == nullptr && !isLastAttempt) || request.isSettled.exchange(true)) {
 			return;
 		}
+		Unregister(request);
+		std::vector<Subscriber> subscribers;
+		{
+			// Later requests for the story start afresh
+			std::lock_guard<std::mutex> lock(mPendingMutex);
+			mRequestsById.erase(request.storyId);
+			subscribers.swap(request.subscribers);
+		}
+		if (story != nullptr && isHedge) {
+			++mHedgeWinCount;
+		}
+		for (const auto& subscriber : subscribers) {
+			const auto& arena = subscriber.batch->data->Arena;
+			if (story != nullptr && arena != request.arena) {
+				// Joined from a batch for another list, which may outlive the
+				// arena the story was parsed into
+				subscriber.batch->data->OnFetchComplete(story->CopyInto(*arena), subscriber.index);
+			} else if (story != nullptr) {
+				subscriber.batch->data->OnFetchComplete(*story, subscriber.index);
+			} else {
+				subscriber.batch->data->OnFetchFailed(subscriber.index);
+			}
+			--subscriber.batch->remaining;
+		}
+	}
+
+	NewsFetcher::Clock::duration NewsFetcher::GetBackoffDelay(const unsigned attempt) {
+		// Full jitter, so that stories failing together don't retry together
+		auto ceiling = kBackoffBase * (1LL << std::min(attempt - 1, 16u));
+		if (ceiling > kBackoffCap) {
+			ceiling = kBackoffCap;
+		}
+		// Seeded once a thread, draws in the same clock tick still differ
+		thread_local std::minstd_rand random(std::random_device{}());
+		std::uniform_int_distribution<Clock::rep> distribution(0, ceiling.count());
+		return Clock::duration(distribution(random));
+	}
+
+	void NewsFetcher::PumpEventLoop() {
+		for (;;) {
+			if (mEventLoopInFlight++ >= kEventLoopWindow) {
+				--mEventLoopInFlight;
+				return;
+			}
+			auto request = PopNextRequest();
+			if (request == nullptr) {
+				--mEventLoopInFlight;
+				return;
+			}
+			request->start = Clock::now();
+			StartEventLoopAttempt(request, 0, Clock::duration::zero());
+		}
+	}
+
+	void NewsFetcher::StartEventLoopAttempt(const std::shared_ptr<ItemRequest>& request, const unsigned attempt, const Clock::duration delay) {
+		auto item = std::make_shared<CachedItem>();
+		bool isFresh = false;
+		if (mItemCache != nullptr && mItemCache->TryGet(request->storyId, *item, isFresh) && isFresh) {
+			FinishEventLoopAttempt(request, attempt, *item, false);
+			return;
+		}
+
+		auto path = kBasePath + "/item/" + std::to_string(request->storyId) + ".json";
+		auto sent = Clock::now() + delay;
+		mEventLoop->Submit(path, item->validators, delay, [this, request, attempt, item, sent](FetchResult result, std::vector<char>&& body, const Validators& validators) {
+			if (result == FetchResult::Failed) {
+				RetryEventLoopAttempt(request, attempt);
+			} else if (result == FetchResult::NotModified) {
+				mLatencyTracker.Add(Clock::now() - sent);
+				mItemCache->Revalidated(request->storyId, *item);
+				FinishEventLoopAttempt(request, attempt, *item, false);
+			} else {
+				mLatencyTracker.Add(Clock::now() - sent);
+				item->body = std::move(body);
+				item->validators = validators;
+				FinishEventLoopAttempt(request, attempt, *item, true);
+			}
+			// Whatever this request settled made room for the next
+			PumpEventLoop();
+		});
+	}
+
+	void NewsFetcher::FinishEventLoopAttempt(const std::shared_ptr<ItemRequest>& request, const unsigned attempt, CachedItem& item, const bool shouldCache) {
+		auto json = AcquireBuffer();
+		json.assign(item.body.begin(), item.body.end());
+		json.push_back('\0'); // Terminator for in situ parsing
+		rapidjson::Document document;
+		Story story;
+		bool isParsed = !document.ParseInsitu(json.data()).HasParseError();
+		bool isGone = isParsed && IsGone(document);
+		bool isLoaded = isParsed && !isGone && TryReadStory(document, *request->arena, mAuthors, mHosts, story);
+		ReleaseBuffer(std::move(json));
+		if (isGone) {
+			CompleteEventLoopRequest(request, nullptr);
+			return;
+		}
+		if (!isLoaded) {
+			if (!shouldCache && mItemCache != nullptr) {
+				// Served from the cache, which would serve the same bytes
+				// to every retry
+				mItemCache->Evict(request->storyId);
+			}
+			RetryEventLoopAttempt(request, attempt);
+			return;
+		}
+
+		story.id = request->storyId;
+		if (shouldCache && mItemCache != nullptr) {
+			item.fetchTime = std::time(nullptr);
+			item.storyTime = story.time;
+			mItemCache->Put(story.id, std::move(item));
+		}
+		CompleteEventLoopRequest(request, &story);
+	}
+
+	void NewsFetcher::RetryEventLoopAttempt(const std::shared_ptr<ItemRequest>& request, const unsigned attempt) {
+		// The loop thread never sleeps, the backoff delays the submission
+		// instead
+		if (attempt + 1 < kMaxAttempts) {
+			auto delay = GetBackoffDelay(attempt + 1);
+			if (Clock::now() + delay < request->start + kItemDeadline) {
+				++mRetryCount;
+				StartEventLoopAttempt(request, attempt + 1, delay);
+				return;
+			}
+		}
+		CompleteEventLoopRequest(request, nullptr);
+	}
+
+	void NewsFetcher::CompleteEventLoopRequest(const std::shared_ptr<ItemRequest>& request, const Story* story) {
+		--mEventLoopInFlight;
+		Settle(*request, false, story);
+	}
+
+	NewsFetcher::ItemRequest::ItemRequest(
+		NewsFetcher* nf,
+		const StoryId sid) :
+		fetcher(nf),
+		storyId(sid),
+		isSettled(false),
+		attemptsOutstanding(1),
+		isHedged(false),
+		priority(FetchPriority::Visible),
+		sequence(0) {}
+
+	void NewsFetcher::RunAttempts(std::unique_ptr<ThreadData> td) {
+		auto& request = *td->request;
+		auto fetcher = request.fetcher;
+		if (!td->isHedge) {
+			// Hedging is measured from when the story started loading, not
+			// from when it was queued
+			request.start = Clock::now();
+			fetcher->Register(td->request);
+		}
 		Story story;
-		story.id = td->storyId;
-		story.title = document[L"title"].GetString();
-		story.url = document[L"url"].GetString();
-		story.score = document[L"score"].GetUint();
-		if (document.HasMember(L"descendants")) {
-			story.descendants = document[L"descendants"].GetUint();
+		bool isLoaded = fetcher->TryLoadStory(request, td->isHedge ? 1 : kMaxAttempts, story);
+		fetcher->Settle(request, td->isHedge, isLoaded ? &story : nullptr);
+	}
+
+	void CALLBACK NewsFetcher::ThreadCallback(PTP_CALLBACK_INSTANCE, void *context) {
+		auto request = static_cast<NewsFetcher*>(context)->PopNextRequest();
+		if (request != nullptr) {
+			RunAttempts(std::unique_ptr<ThreadData>(new ThreadData{ std::move(request), false }));
 		}
-		story.time = document[L"time"].GetInt64();
-		story.by = document[L"by"].GetString();
+	}
+
+	void CALLBACK NewsFetcher::HedgeCallback(PTP_CALLBACK_INSTANCE, void *context) {
+		RunAttempts(std::unique_ptr<ThreadData>(static_cast<ThreadData *>(context)));
+	}
 
-		(*td->successCallback)(story, td->index);
+	void CALLBACK NewsFetcher::HedgeTimerCallback(PTP_CALLBACK_INSTANCE, void *context, PTP_TIMER) {
+		auto fetcher = static_cast<NewsFetcher*>(context);
+		Clock::duration threshold;
+		if (!fetcher->mLatencyTracker.TryGetPercentile(kHedgePercentile, threshold)) {
+			return;
+		}
+		auto now = Clock::now();
+		std::lock_guard<std::mutex> lock(fetcher->mInFlightMutex);
+		for (const auto& request : fetcher->mInFlight) {
+			if (request->isHedged || request->isSettled || now - request->start < threshold) {
+				continue;
+			}
+			// One hedge per story, it only races the slow attempt
+			request->isHedged = true;
+			++request->attemptsOutstanding;
+			auto td = new ThreadData{ request, true };
+			if (!::TrySubmitThreadpoolCallback(HedgeCallback, td, fetcher->mThreadpoolCallbackEnvironment)) {
+				delete td;
+				--request->attemptsOutstanding;
+				continue;
+			}
+			++fetcher->mHedgeCount;
+		}
+	}
+
+	void CALLBACK NewsFetcher::TopStoriesCallback(PTP_CALLBACK_INSTANCE, void *context) {
+		std::unique_ptr<ListThreadData> td(static_cast<ListThreadData*>(context));
+		std::vector<StoryId> topStories;
+		try {
+			td->fetcher->FetchTopStoryIds([&topStories](StoryId id) {
+				topStories.push_back(id);
+			});
+		} catch (const std::runtime_error&) {
+			return;
+		}
+		td->onList(std::move(topStories));
 	}
 } // namespace hackernewscmd
\ No newline at end of file
@@ -20,64 +20,243 @@
 #pragma once
 
 #include <Windows.h>
-#include <Wininet.h>
+#include <atomic>
+#include <chrono>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
+#include "concurrency_limiter.h"
+#include "item_cache.h"
+#include "latency_tracker.h"
 #include "story.h"
-
-#pragma comment(lib, "Wininet")
+#include "string_arena.h"
+#include "top_stories_subscription.h"
+#include "transport.h"
 
 
 namespace hackernewscmd {
+	// Queued stories are loaded in this order, earliest queued first within
+	// a class
+	enum class FetchPriority {
+		Visible,
+		Adjacent,
+		Background
+	};
+
 	struct FetchThreadData {
 		const std::vector<std::pair<StoryId, size_t>> ToBeLoaded;
 		const std::function<void(Story, size_t)> OnFetchComplete;
 		const std::function<void(size_t)> OnFetchFailed;
+		// Called on the cancelling thread, for stories that never started
+		const std::function<void(size_t)> OnFetchCancelled;
+		// Where the stories handed to OnFetchComplete keep their strings
+		const std::shared_ptr<StringArena> Arena;
+		const FetchPriority Priority;
 
-		FetchThreadData(decltype(ToBeLoaded) && toBeLoaded, decltype(OnFetchComplete)&& onFetchComplete, decltype(OnFetchFailed) onFetchFailed) :
+		FetchThreadData(decltype(ToBeLoaded) && toBeLoaded, decltype(OnFetchComplete)&& onFetchComplete, decltype(OnFetchFailed) onFetchFailed, decltype(OnFetchCancelled) onFetchCancelled, decltype(Arena) arena, FetchPriority priority = FetchPriority::Visible) :
 			ToBeLoaded(std::move(toBeLoaded)),
 			OnFetchComplete(std::move(onFetchComplete)),
-			OnFetchFailed(std::move(onFetchFailed)) {};
+			OnFetchFailed(std::move(onFetchFailed)),
+			OnFetchCancelled(std::move(onFetchCancelled)),
+			Arena(std::move(arena)),
+			Priority(priority) {};
 		FetchThreadData& operator=(const FetchThreadData&) = delete;
 	};
 
+	class NewsFetcher;
+
+	struct FetchBatch {
+		FetchBatch(NewsFetcher*, const FetchThreadData*);
+		FetchBatch& operator=(const FetchBatch&) = delete;
+
+		NewsFetcher* const fetcher;
+		const std::unique_ptr<const FetchThreadData> data;
+		std::atomic<std::size_t> remaining; // Stories not yet loaded, failed or cancelled
+	};
+
+	/**
+	 * Refers to a batch of stories handed to the fetcher. Copies refer to the
+	 * same batch, a default constructed handle refers to none.
+	 */
+	class FetchHandle {
+	public:
+		FetchHandle() {};
+
+		bool IsDone() const;
+		// Stories that haven't started loading are dropped, the rest are
+		// left to finish
+		void Cancel() const;
+
+	private:
+		friend class NewsFetcher;
+		explicit FetchHandle(const std::shared_ptr<FetchBatch>& batch) : mBatch(batch) {};
+
+		std::shared_ptr<FetchBatch> mBatch;
+	}; // class FetchHandle
+
+	struct RetryStats {
+		unsigned long retries;
+		unsigned long hedges;
+		unsigned long hedgesWon;
+	};
+
+	struct StoryStorageStats {
+		std::size_t bytes; // Of the authors and hosts interned
+		std::size_t authors;
+		std::size_t hosts;
+	};
+
 	class NewsFetcher {
 	public:
-		NewsFetcher();
+		// The item cache and event loop are optional. Stories are fetched on
+		// the event loop, a fetch session of the transport's, when there is
+		// one, and on the thread pool otherwise.
+		NewsFetcher(Transport&, ItemCache*, FetchSession* = nullptr);
 		~NewsFetcher();
-		std::vector<unsigned long long> FetchTopStoryIds();
-		void FetchStories(const FetchThreadData*);
+		// Streams ids to the callback while the list is still downloading
+		void FetchTopStoryIds(const std::function<void(StoryId)>&);
+		// Downloads the list on the thread pool, and hands it to the callback
+		// there. Nothing is handed out if it can't be had.
+		void FetchTopStoryIdsAsync(const std::function<void(std::vector<StoryId>)>&);
+		// Hands out the whole list whenever it changes, until the
+		// subscription is destroyed
+		std::unique_ptr<TopStoriesSubscription> SubscribeTopStoryIds(const std::function<void(std::vector<StoryId>)>&);
+		// Returns as soon as the batch is queued
+		FetchHandle FetchStories(const FetchThreadData*);
+		// Reassigns the priority of every queued story, by its index
+		void Reprioritise(const std::function<FetchPriority(std::size_t)>&);
+		ConnectionStats GetConnectionStats() const;
+		unsigned GetConcurrencyLimit() const;
+		unsigned GetRequestsInFlight() const;
+		RetryStats GetRetryStats() const;
+		// Requests that shared a story already queued or loading
+		unsigned long GetCoalescedCount() const;
+		StoryStorageStats GetStoryStorageStats() const;
+		// Authors of the stories handed out, by their id
+		const StringTable& GetAuthors() const { return mAuthors; }
+		// Hosts of the stories' URLs, lower cased, by their id
+		const StringTable& GetHosts() const { return mHosts; }
+
+		static const std::string kHost;
 
 	private:
-		HINTERNET mInternetHandle;
+		Transport& mTransport;
+		ItemCache* mItemCache;
+		FetchSession* mEventLoop;
+		std::atomic<unsigned> mEventLoopInFlight;
+		ConcurrencyLimiter mLimiter;
+		std::atomic<unsigned> mThreadMaximum;
 		PTP_POOL mThreadpool;
 		PTP_CALLBACK_ENVIRON mThreadpoolCallbackEnvironment;
-		static const unsigned long kMaxThreads = 5;
-		static const std::string kBaseUrl;
+		// Nothing waits on a batch, the fetcher waits for whatever is still
+		// running when it goes away
+		PTP_CLEANUP_GROUP mCleanupGroup;
+		static const unsigned kInitialConcurrency = 5;
+		static const unsigned kMinConcurrency = 2;
+		static const unsigned kMaxConcurrency = 32;
+		static const std::string kBasePath;
 		static const std::string kTopStories;
 
-		HINTERNET GetInternetHandle();
+		std::vector<std::vector<char>> mBuffers;
+		std::mutex mBuffersMutex;
+
 		PTP_CALLBACK_ENVIRON GetThreadpoolCallbackEnvironment();
-		std::vector<wchar_t> FetchUrl(const std::string&);
+		// Returns true if the body came over the network and should be cached
+		bool FetchItem(const StoryId, std::vector<char>&, CachedItem&);
+		void ApplyConcurrencyLimit();
+		std::vector<char> AcquireBuffer();
+		void ReleaseBuffer(std::vector<char>&&);
 
 		// Threadpool related
-		struct ThreadData {
-			ThreadData(
-				NewsFetcher*,
-				const StoryId,
-				const std::size_t,
-				const std::function<void(Story, std::size_t)>*,
-				const std::function<void(std::size_t)>*);
-			ThreadData& operator=(const ThreadData&) = delete;
+		using Clock = LatencyTracker::Clock;
+
+		struct Subscriber {
+			std::shared_ptr<FetchBatch> batch;
+			std::size_t index;
+		};
+
+		// One per story being loaded, however many batches asked for it.
+		// Shared by every attempt at loading the story, the first attempt to
+		// succeed settles it.
+		struct ItemRequest {
+			ItemRequest(NewsFetcher*, const StoryId);
+			ItemRequest& operator=(const ItemRequest&) = delete;
 
 			NewsFetcher* fetcher;
 			const StoryId storyId;
-			const std::size_t index;
-			const std::function<void(Story, std::size_t)> *successCallback;
-			const std::function<void(std::size_t)> *failureCallback;
+			Clock::time_point start; // Set before the request is registered
+			std::atomic<bool> isSettled;
+			std::atomic<unsigned> attemptsOutstanding;
+			bool isHedged; // Guarded by mInFlightMutex
+			std::vector<Subscriber> subscribers; // Guarded by mPendingMutex
+			FetchPriority priority; // Guarded by mPendingMutex
+			unsigned long long sequence;
+			// The first subscriber's, the story is parsed into it
+			std::shared_ptr<StringArena> arena;
+		};
+		struct ThreadData {
+			std::shared_ptr<ItemRequest> request;
+			bool isHedge;
+		};
+		struct ListThreadData {
+			NewsFetcher* fetcher;
+			std::function<void(std::vector<StoryId>)> onList;
 		};
-		static void CALLBACK ThreadCallback(PTP_CALLBACK_INSTANCE, void*, PTP_WORK);
+
+		std::vector<std::shared_ptr<ItemRequest>> mPending;
+		std::unordered_map<StoryId, std::shared_ptr<ItemRequest>> mRequestsById; // Queued or loading
+		unsigned long long mNextSequence;
+		std::atomic<unsigned long> mCoalescedCount;
+		std::mutex mPendingMutex;
+		LatencyTracker mLatencyTracker;
+		std::vector<std::shared_ptr<ItemRequest>> mInFlight;
+		std::mutex mInFlightMutex;
+		PTP_TIMER mHedgeTimer;
+		std::atomic<unsigned long> mRetryCount;
+		std::atomic<unsigned long> mHedgeCount;
+		std::atomic<unsigned long> mHedgeWinCount;
+		static const unsigned kMaxAttempts = 4;
+		static const unsigned kHedgePercentile = 95;
+		static const Clock::duration kItemDeadline;
+		static const Clock::duration kBackoffBase;
+		static const Clock::duration kBackoffCap;
+		static const DWORD kHedgeScanIntervalMs = 25;
+		static const unsigned kEventLoopWindow = 256; // Stories handed to the event loop at once
+
+		// Holds the authors and hosts interned, for as long as the fetcher
+		// lives. They're few and much repeated, unlike titles and URLs, which
+		// go to the arena of the list they were fetched for.
+		StringArena mInternedArena;
+		StringTable mAuthors;
+		StringTable mHosts;
+
+		// Returns nothing when the story joined a request already under way
+		std::shared_ptr<ItemRequest> Enqueue(const std::shared_ptr<FetchBatch>&, const StoryId, const std::size_t);
+		void Cancel(FetchBatch&);
+		std::shared_ptr<ItemRequest> PopNextRequest();
+		bool TryLoadStory(ItemRequest&, const unsigned, Story&);
+		void Register(const std::shared_ptr<ItemRequest>&);
+		void Unregister(const ItemRequest&);
+		void Settle(ItemRequest&, const bool, const Story*);
+		static Clock::duration GetBackoffDelay(const unsigned);
+
+		// Event loop related, there are no hedges since no thread waits on a
+		// slow request
+		void PumpEventLoop();
+		void StartEventLoopAttempt(const std::shared_ptr<ItemRequest>&, const unsigned, const Clock::duration);
+		void FinishEventLoopAttempt(const std::shared_ptr<ItemRequest>&, const unsigned, CachedItem&, const bool);
+		void RetryEventLoopAttempt(const std::shared_ptr<ItemRequest>&, const unsigned);
+		void CompleteEventLoopRequest(const std::shared_ptr<ItemRequest>&, const Story*);
+		static void RunAttempts(std::unique_ptr<ThreadData>);
+		static void CALLBACK ThreadCallback(PTP_CALLBACK_INSTANCE, void*);
+		static void CALLBACK HedgeCallback(PTP_CALLBACK_INSTANCE, void*);
+		static void CALLBACK HedgeTimerCallback(PTP_CALLBACK_INSTANCE, void*, PTP_TIMER);
+		static void CALLBACK TopStoriesCallback(PTP_CALLBACK_INSTANCE, void*);
+
+		friend class FetchHandle;
 	};
 } // namespace hackernewscmd
\ No newline at end of file
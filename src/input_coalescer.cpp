@@ -0,0 +1,90 @@
+/**
+ * @file input_coalescer.cpp
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "input_coalescer.h"
+#include <algorithm>
+
+#undef min
+#undef max
+
+
+namespace hackernewscmd {
+	std::vector<CoalescedAction> InputCoalescer::Coalesce(const std::vector<InputAction>& actions) {
+		std::vector<CoalescedAction> result;
+		CoalescedAction::Kind kind;
+		long step;
+		bool isSkip;
+
+		for (auto action : actions) {
+			if (!TryGetStep(action, kind, step, isSkip)) {
+				CoalescedAction other = { CoalescedAction::Other, action, 0, 0, 0 };
+				result.push_back(other);
+				continue;
+			}
+
+			// Stories and pages don't fold into each other, and neither do
+			// skips that would leave a gap between the positions marked
+			if (result.empty() || result.back().kind != kind
+				|| (isSkip && !CanSkipFrom(result.back(), result.back().distance))) {
+				CoalescedAction move = { kind, InputAction::Unknown, 0, 0, 0 };
+				result.push_back(move);
+			}
+			auto& move = result.back();
+			if (isSkip) {
+				// The position being left is marked, as one step would have
+				if (move.skipBegin == move.skipEnd) {
+					move.skipBegin = move.distance;
+					move.skipEnd = move.distance + 1;
+				} else {
+					move.skipBegin = std::min(move.skipBegin, move.distance);
+					move.skipEnd = std::max(move.skipEnd, move.distance + 1);
+				}
+			}
+			move.distance += step;
+		}
+		return result;
+	}
+
+	bool InputCoalescer::CanSkipFrom(const CoalescedAction& move, long position) {
+		return move.skipBegin == move.skipEnd || (position >= move.skipBegin - 1 && position <= move.skipEnd);
+	}
+
+	bool InputCoalescer::TryGetStep(InputAction action, CoalescedAction::Kind& kind, long& step, bool& isSkip) {
+		using IA = InputAction;
+		switch (action) {
+		case IA::NextStory:
+		case IA::NextStorySkip:
+		case IA::PrevStory:
+		case IA::PrevStorySkip:
+			kind = CoalescedAction::MoveStories;
+			break;
+		case IA::NextPage:
+		case IA::NextPageSkip:
+		case IA::PrevPage:
+		case IA::PrevPageSkip:
+			kind = CoalescedAction::MovePages;
+			break;
+		default:
+			return false;
+		}
+		step = action == IA::NextStory || action == IA::NextStorySkip || action == IA::NextPage || action == IA::NextPageSkip ? 1 : -1;
+		isSkip = action == IA::NextStorySkip || action == IA::PrevStorySkip || action == IA::NextPageSkip || action == IA::PrevPageSkip;
+		return true;
+	}
+} // namespace hackernewscmd
\ No newline at end of file
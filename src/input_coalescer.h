@@ -0,0 +1,56 @@
+/**
+ * @file input_coalescer.h
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <vector>
+#include "interact.h"
+
+
+namespace hackernewscmd {
+	/**
+	 * A run of navigation actions folded into where it ends up, or any
+	 * other action as it was read.
+	 * Positions are counted in stories or pages, relative to where the run
+	 * started. A run only goes on for as long as the positions it left
+	 * through skipping actions are next to each other.
+	 */
+	struct CoalescedAction {
+		enum Kind { MoveStories, MovePages, Other } kind;
+		InputAction action; // For Other
+		long distance; // Net movement
+		long skipBegin, skipEnd; // Positions to mark skipped, half open
+	}; // struct CoalescedAction
+
+	/**
+	 * Folds each run of story or page navigation, which a held key delivers
+	 * one repeat at a time, into a single movement, so that it's carried
+	 * out and drawn once.
+	 */
+	class InputCoalescer {
+	public:
+		static std::vector<CoalescedAction> Coalesce(const std::vector<InputAction>&);
+
+	private:
+		// The direction of a navigation action, and whether it skips
+		static bool TryGetStep(InputAction, CoalescedAction::Kind&, long&, bool&);
+		// Whether marking the position keeps the marked ones together
+		static bool CanSkipFrom(const CoalescedAction&, long);
+	}; // class InputCoalescer
+} // namespace hackernewscmd
\ No newline at end of file
@@ -53,32 +53,18 @@ namespace hackernewscmd {
 
 	void InputManager::ProcessActions(const std::vector<InputAction>& actions) {
 		using IA = InputAction;
-		for (const auto action : actions) {
-			switch (action) {
-			case IA::NextStory:
-				mStateManager.SelectNextStory(false);
-				break;
-			case IA::NextStorySkip:
-				mStateManager.SelectNextStory(true);
-				break;
-			case IA::PrevStory:
-				mStateManager.SelectPrevStory(false);
-				break;
-			case IA::PrevStorySkip:
-				mStateManager.SelectPrevStory(true);
-				break;
-			case IA::NextPage:
-				mStateManager.GotoNextPage(false);
-				break;
-			case IA::NextPageSkip:
-				mStateManager.GotoNextPage(true);
-				break;
-			case IA::PrevPage:
-				mStateManager.GotoPrevPage(false);
-				break;
-			case IA::PrevPageSkip:
-				mStateManager.GotoPrevPage(true);
-				break;
+		// Held keys arrive as runs of repeats, each of which is only carried
+		// out once
+		for (const auto& coalesced : InputCoalescer::Coalesce(actions)) {
+			switch (coalesced.kind) {
+			case CoalescedAction::MoveStories:
+				mStateManager.MoveSelection(coalesced.distance, coalesced.skipBegin, coalesced.skipEnd);
+				continue;
+			case CoalescedAction::MovePages:
+				mStateManager.TurnPages(coalesced.distance, coalesced.skipBegin, coalesced.skipEnd);
+				continue;
+			}
+			switch (coalesced.action) {
 			case IA::OpenStory:
 				mStateManager.OpenSelectedStory(false);
 				break;
@@ -86,7 +72,10 @@ namespace hackernewscmd {
 				mStateManager.OpenSelectedStory(true);
 				break;
 			case IA::RefreshStories:
-				// TODO
+				mStateManager.RefreshStories();
+				break;
+			case IA::UpdateStories:
+				mStateManager.ApplyStreamedTopStories();
 				break;
 			case IA::Quit:
 				mInputState = InputState::Quit;
@@ -21,6 +21,7 @@
 
 #include <string>
 #include <thread>
+#include "input_coalescer.h"
 #include "interact.h"
 #include "state_manager.h"
 
@@ -29,14 +29,14 @@
 namespace hackernewscmd {
 	Interact::Interact() :
 		mInputHandle(NULL),
-		mOutputHandle(NULL),
-		mOriginalOutputHandle(NULL),
-		mNextRow(0) {}
+		mNextRow(0),
+		mRenderStats() {}
 
 	Interact::~Interact() {
-		::SetConsoleActiveScreenBuffer(mOriginalOutputHandle);
-		::CloseHandle(mInputHandle);
-		::CloseHandle(mOutputHandle);
+		mTerminal.reset();
+		if (mInputHandle != NULL) {
+			::CloseHandle(mInputHandle);
+		}
 	};
 
 	void Interact::Init() {
@@ -48,30 +48,19 @@ namespace hackernewscmd {
 		::GetConsoleMode(mInputHandle, &currentMode);
 		::SetConsoleMode(mInputHandle, currentMode & inputModeClearMask);
 
-		if ((mOriginalOutputHandle = ::CreateFileW(L"CONOUT$", GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL)) == INVALID_HANDLE_VALUE) {
-			throw std::runtime_error("Couldn'e open console output handle");
-		}
-		if ((mOutputHandle = ::CreateConsoleScreenBuffer(GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, CONSOLE_TEXTMODE_BUFFER, NULL)) == INVALID_HANDLE_VALUE) {
-			throw std::runtime_error("Couldn't create new screen buffer");
-		}
-		if (::SetConsoleActiveScreenBuffer(mOutputHandle) == 0) {
-			throw std::runtime_error("Couldn't set active screen buffer");
-		}
-		CONSOLE_SCREEN_BUFFER_INFO csbi;
-		if (::GetConsoleScreenBufferInfo(mOutputHandle, &csbi) == 0) {
-			throw std::runtime_error("Couldn't load screen buffer info");
-		}
-		mBufferSize = csbi.dwSize;
-		mBufferAttributes = csbi.wAttributes & ~FOREGROUND_INTENSITY;
-		mSelectedStoryAttributes = csbi.wAttributes | FOREGROUND_INTENSITY;
-		mRowBuffer.resize(csbi.dwSize.X);
-
-		CONSOLE_CURSOR_INFO cci{ 1, false };
-		if (!::SetConsoleCursorInfo(mOutputHandle, &cci)) {
-			throw std::runtime_error("Couldn't hide cursor " + std::to_string(::GetLastError()));
+		if (mTerminalType == TerminalType::Virtual) {
+			UseTerminal(std::make_unique<VirtualTerminal>());
+		} else {
+			UseTerminal(std::make_unique<ConsoleTerminal>());
 		}
 	}
 
+	void Interact::UseTerminal(std::unique_ptr<Terminal> terminal) {
+		mTerminal = std::move(terminal);
+		mBufferAttributes = mTerminal->GetDefaultAttributes() & ~FOREGROUND_INTENSITY;
+		mSelectedStoryAttributes = mTerminal->GetDefaultAttributes() | FOREGROUND_INTENSITY;
+	}
+
 	StoryDisplayData Interact::ShowStory(const std::wstring& title, const unsigned score, const std::wstring& host) const {
 		return ShowStoryInternal(title, score, host, -1);
 	}
@@ -82,23 +71,53 @@ namespace hackernewscmd {
 
 	void Interact::ShowPagePosition(const long currentPage, const long totalPages) const {
 		PrintLineWithinCols(L"Page " + std::to_wstring(currentPage) + L" of " + std::to_wstring(totalPages),
-			mNextRow, 0, mBufferSize.X - 1, true);
+			mNextRow, 0, mTerminal->GetSize().X - 1, true);
 	}
 
 	StoryDisplayData Interact::ShowFailedStory() const {
 		StoryDisplayData sdd = GetStoryDisplayDataStartingAtNextRow();
-		mNextRow = PrintLineWithinCols(L"-- Story download failed --", mNextRow, 2, mBufferSize.X - 1) + 1;
+		mNextRow = PrintLineWithinCols(L"-- Story download failed --", mNextRow, 2, mTerminal->GetSize().X - 1) + 1;
 		sdd.margin.Bottom = sdd.text.Bottom = mNextRow - 2;
 		return sdd;
 	}
 
+	StoryDisplayData Interact::ShowStoryPlaceholder() const {
+		StoryDisplayData sdd = GetStoryDisplayDataStartingAtNextRow();
+		mNextRow = PrintLineWithinCols(L"-- Loading --", mNextRow, 2, mTerminal->GetSize().X - 1);
+		sdd.text.Bottom = mNextRow - 1;
+		// An empty addendum, where the story's will go
+		sdd.addendum.Left = sdd.text.Left;
+		sdd.addendum.Right = sdd.text.Right;
+		sdd.margin.Bottom = sdd.addendum.Top = sdd.addendum.Bottom = mNextRow;
+		mTerminal->Resize(mNextRow + 1);
+		mNextRow += 2;
+		return sdd;
+	}
+
+	short Interact::GetNextRow() const {
+		return mNextRow;
+	}
+
+	void Interact::SetNextRow(short row) const {
+		mNextRow = row;
+	}
+
+	void Interact::ClearRows(short top, short bottom) const {
+		auto width = mTerminal->GetSize().X;
+		std::wstring blanks(width, L' ');
+		for (auto row = top; row <= bottom; ++row) {
+			mTerminal->WriteText({ 0, row }, blanks.c_str(), blanks.length());
+		}
+		mTerminal->SetAttributes({ 0, top, short(width - 1), bottom }, mBufferAttributes);
+	}
+
 	void Interact::SwapSelectedStories(const StoryDisplayData& prev, const StoryDisplayData& curr) const {
+		// All of it goes out together when presented, and only the cells
+		// that changed
+
 		// Move asterisk
-		unsigned long charsWritten;
-		if (::WriteConsoleOutputCharacterW(mOutputHandle, L" ", 1, { prev.margin.Left, prev.margin.Top }, &charsWritten) == 0
-			|| ::WriteConsoleOutputCharacterW(mOutputHandle, L"*", 1, { curr.margin.Left, curr.margin.Top }, &charsWritten) == 0) {
-			throw std::runtime_error("Couldn't write character");
-		}
+		mTerminal->WriteText({ prev.margin.Left, prev.margin.Top }, L" ", 1);
+		mTerminal->WriteText({ curr.margin.Left, curr.margin.Top }, L"*", 1);
 
 		// Recolor
 
@@ -106,33 +125,37 @@ namespace hackernewscmd {
 		if (prev.addendum.Bottom != -1) {
 			rect.Bottom = prev.addendum.Bottom;
 		}
-		ChangeBufferAttributes(rect, mBufferAttributes);
+		mTerminal->SetAttributes(rect, mBufferAttributes);
 		rect = curr.text;
 		if (curr.addendum.Bottom != -1) {
 			rect.Bottom = curr.addendum.Bottom;
 		}
-		ChangeBufferAttributes(rect, mSelectedStoryAttributes);
+		mTerminal->SetAttributes(rect, mSelectedStoryAttributes);
 
 		// Scroll
 
 		auto bottom = curr.addendum.Bottom == -1 ? curr.text.Bottom : curr.addendum.Bottom;
-		if (!::SetConsoleCursorPosition(mOutputHandle, { 0, bottom })
-			|| !::SetConsoleCursorPosition(mOutputHandle, { 0, curr.text.Top })) {
-			throw std::runtime_error("Couldn't move cursor to location of story");
+		mTerminal->ScrollTo(curr.text.Top, bottom);
+	}
+
+	void Interact::Present() const {
+		auto callCount = mTerminal->GetCallCount();
+		mTerminal->Flush();
+		// Nothing changed, nothing drawn
+		if (mTerminal->GetCallCount() != callCount) {
+			++mRenderStats.frames;
 		}
 	}
 
+	RenderStats Interact::GetRenderStats() const {
+		auto stats = mRenderStats;
+		stats.consoleCalls = mTerminal ? mTerminal->GetCallCount() : 0;
+		return stats;
+	}
+
 	void Interact::ClearScreen() const {
-		COORD root{ 0, 0 };
-		auto bufferSize = mBufferSize.X * mBufferSize.Y;
-		unsigned long charsWritten;
-		if (::FillConsoleOutputCharacterW(mOutputHandle, L' ', bufferSize, root, &charsWritten) == 0) {
-			throw std::runtime_error("Couldn't fill screen with blanks");
-		}
-		if (::FillConsoleOutputAttribute(mOutputHandle, mBufferAttributes, bufferSize, root, &charsWritten) == 0) {
-			throw std::runtime_error("Couldn't set attributes for screen buffer");
-		}
-		::SetConsoleCursorPosition(mOutputHandle, root);
+		mTerminal->Clear(mBufferAttributes);
+		mTerminal->ScrollTo(0, 0);
 		mNextRow = 0;
 	}
 
@@ -168,6 +191,10 @@ namespace hackernewscmd {
 
 			for (auto i = 0UL; i < eventsRead; ++i) {
 				auto& item = buff[i];
+				if (item.EventType == MENU_EVENT && item.Event.MenuEvent.dwCommandId >= kPostedActionCommandBase) {
+					actions.push_back(static_cast<InputAction>(item.Event.MenuEvent.dwCommandId - kPostedActionCommandBase));
+					continue;
+				}
 				if (item.EventType != KEY_EVENT || !item.Event.KeyEvent.bKeyDown) {
 					continue;
 				}
@@ -221,15 +248,21 @@ namespace hackernewscmd {
 		return actions;
 	}
 
-	StoryDisplayData Interact::ShowStoryInternal(const std::wstring& title, const unsigned score, const std::wstring& hostname, const long comments) const {
-		CONSOLE_SCREEN_BUFFER_INFO csbi;
-		if (::GetConsoleScreenBufferInfo(mOutputHandle, &csbi) == 0) {
-			throw std::runtime_error("Couldn't load screen buffer info");
+	void Interact::PostAction(InputAction action) const {
+		INPUT_RECORD record{};
+		record.EventType = MENU_EVENT;
+		record.Event.MenuEvent.dwCommandId = kPostedActionCommandBase + static_cast<UINT>(action);
+		unsigned long eventsWritten;
+		if (!::WriteConsoleInputW(mInputHandle, &record, 1, &eventsWritten)) {
+			throw std::runtime_error("Couldn't post to input buffer");
 		}
+	}
 
+	StoryDisplayData Interact::ShowStoryInternal(const std::wstring& title, const unsigned score, const std::wstring& hostname, const long comments) const {
 		StoryDisplayData sdd = GetStoryDisplayDataStartingAtNextRow();
+		auto right = short(mTerminal->GetSize().X - 1);
 
-		mNextRow = PrintLineWithinCols(title, mNextRow, 2, mBufferSize.X - 1);
+		mNextRow = PrintLineWithinCols(title, mNextRow, 2, right);
 		sdd.text.Bottom = mNextRow - 1;
 
 		sdd.addendum.Left = sdd.text.Left;
@@ -239,7 +272,7 @@ namespace hackernewscmd {
 		if (comments > 0) {
 			addendum += L" [" + std::to_wstring(comments) + (comments == 1 ? L" comment" : L" comments") + L']';
 		}
-		mNextRow = PrintLineWithinCols(addendum, mNextRow, 2, mBufferSize.X - 1);
+		mNextRow = PrintLineWithinCols(addendum, mNextRow, 2, right);
 		sdd.margin.Bottom = sdd.addendum.Bottom = mNextRow - 1;
 
 		++mNextRow;
@@ -247,30 +280,6 @@ namespace hackernewscmd {
 		return sdd;
 	}
 
-	void Interact::ChangeBufferAttributes(const SMALL_RECT& region, unsigned short attributes) const {
-		auto size = short(region.Right - region.Left + 1);
-		if (size > short(mRowBuffer.size())) {
-			mRowBuffer.resize(size);
-		}
-		COORD root{ 0, 0 };
-		COORD dim{ size, 1 };
-		SMALL_RECT temp;
-		for (auto i = region.Top; i <= region.Bottom; ++i) {
-			temp.Top = temp.Bottom = i;
-			temp.Left = region.Left;
-			temp.Right = region.Right;
-			if (!::ReadConsoleOutputW(mOutputHandle, mRowBuffer.data(), dim, root, &temp)) {
-				throw std::runtime_error("Couldn't read output characters");
-			}
-			for (auto i = 0; i < size; ++i) {
-				mRowBuffer[i].Attributes = attributes;
-			}
-			if (!::WriteConsoleOutputW(mOutputHandle, mRowBuffer.data(), dim, root, &temp)) {
-				throw std::runtime_error("Couldn't write output characters");
-			}
-		}
-	}
-
 	short Interact::PrintLineWithinCols(const std::wstring& line, short row, short left, short right, bool shouldCenter) const {
 		assert(left <= right);
 
@@ -280,20 +289,12 @@ namespace hackernewscmd {
 
 		auto width = right - left + 1;
 		auto numLines = short(row + (line.length() - 1) / width + 1);
-		if (numLines > mBufferSize.Y) {
-			if (!::SetConsoleScreenBufferSize(mOutputHandle, { mBufferSize.X, numLines })) {
-				throw std::runtime_error("Couldn't create space for line");
-			}
-			mBufferSize.Y = numLines;
-		}
+		mTerminal->Resize(numLines);
 
 		for (std::size_t i = 0; i < line.length(); i += width, ++row) {
 			auto length = std::min(i + width, line.length()) - i;
 			auto leftAdjustment = short(shouldCenter ? (width - length) / 2 : 0);
-			unsigned long charsWritten;
-			if (!::WriteConsoleOutputCharacterW(mOutputHandle, line.c_str() + i, length, { left + leftAdjustment, row }, &charsWritten)) {
-				throw std::runtime_error("Couldn't write characters");
-			}
+			mTerminal->WriteText({ short(left + leftAdjustment), row }, line.c_str() + i, length);
 		}
 		return row;
 	}
@@ -305,11 +306,22 @@ namespace hackernewscmd {
 		ret.margin.Left = 0;
 		ret.margin.Right = 1;
 		ret.text.Left = 2;
-		ret.text.Right = mBufferSize.X - 1;
+		ret.text.Right = mTerminal->GetSize().X - 1;
 		return ret;
 	}
 
+	TerminalType Interact::mTerminalType = TerminalType::Console;
+	void Interact::SetTerminalType(TerminalType type) {
+		mTerminalType = type;
+	}
+
 	std::unique_ptr<Interact> Interact::mInstance = nullptr;
+	std::unique_ptr<Interact> Interact::CreateHeadless(std::unique_ptr<Terminal> terminal) {
+		auto interact = std::make_unique<Interact>(Key{});
+		interact->UseTerminal(std::move(terminal));
+		return interact;
+	}
+
 	const Interact& Interact::GetInstance() {
 		if (mInstance == nullptr) {
 			mInstance = std::make_unique<Interact>(Key{});
@@ -24,6 +24,7 @@
 #include <string>
 #include <utility>
 #include <vector>
+#include "terminal.h"
 
 
 namespace hackernewscmd {
@@ -43,6 +44,7 @@ namespace hackernewscmd {
 		OpenStory,
 		OpenStoryPage,
 		RefreshStories,
+		UpdateStories, // Posted when a newer list has been streamed in
 		Quit
 	};
 
@@ -52,6 +54,19 @@ namespace hackernewscmd {
 		SMALL_RECT addendum;
 	};
 
+	/**
+	 * What drawing has cost. Frames are the times drawn up to then was
+	 * shown, and calls those made to the console, frames or not.
+	 */
+	struct RenderStats {
+		unsigned long frames;
+		unsigned long consoleCalls;
+	};
+
+	/**
+	 * Console input, and output drawn through a terminal. Nothing drawn
+	 * shows until it's presented.
+	 */
 	class Interact {
 		struct Key{};
 	public:
@@ -67,29 +82,49 @@ namespace hackernewscmd {
 
 		void ShowPagePosition(long currentPage, long totalPages) const;
 		StoryDisplayData ShowFailedStory() const;
+		// Holds a story's place, as tall as a story whose title fits a line
+		StoryDisplayData ShowStoryPlaceholder() const;
+
+		// Stories are drawn one under the other, from this row on
+		short GetNextRow() const;
+		void SetNextRow(short) const;
+		// Blanks the rows from the first to the last
+		void ClearRows(short, short) const;
 
 		void SwapSelectedStories(const StoryDisplayData&, const StoryDisplayData&) const;
 		void ClearScreen() const;
+		// Shows everything drawn so far, as one frame
+		void Present() const;
+		RenderStats GetRenderStats() const;
 		std::wstring ReadChars() const;
 		std::vector<InputAction> ReadActions() const;
+		// Wakes the reader with an action of the program's own, from any thread
+		void PostAction(InputAction) const;
 
+		// Takes effect when the instance is first got
+		static void SetTerminalType(TerminalType);
 		static const Interact& GetInstance();
+		// Draws to the terminal given rather than the console, reading no
+		// input, so drawing can be measured and inspected
+		static std::unique_ptr<Interact> CreateHeadless(std::unique_ptr<Terminal>);
 	private:
 		Interact();
 		void Init();
+		void UseTerminal(std::unique_ptr<Terminal>);
 		StoryDisplayData ShowStoryInternal(const std::wstring&, const unsigned, const std::wstring&, const long) const;
 		short PrintLineWithinCols(const std::wstring&, short, short, short, bool = false) const;
-		void ChangeBufferAttributes(const SMALL_RECT&, unsigned short) const;
 		StoryDisplayData GetStoryDisplayDataStartingAtNextRow() const;
 
 		HANDLE mInputHandle;
-		HANDLE mOutputHandle;
-		HANDLE mOriginalOutputHandle;
-		mutable COORD mBufferSize;
+		std::unique_ptr<Terminal> mTerminal;
 		unsigned short mBufferAttributes;
 		unsigned short mSelectedStoryAttributes;
 		mutable short mNextRow;
-		mutable std::vector<CHAR_INFO> mRowBuffer;
+		mutable RenderStats mRenderStats;
 		static std::unique_ptr<Interact> mInstance;
+		static TerminalType mTerminalType;
+		// Posted actions travel through the input buffer as menu events, well
+		// clear of the console's own menu command ids
+		static const UINT kPostedActionCommandBase = 0x48430000;
 	}; // class Interact
 } // namespace hackernewscmd
\ No newline at end of file
@@ -0,0 +1,146 @@
+/**
+ * @file item_cache.cpp
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "item_cache.h"
+#include <cstdint>
+#include <fstream>
+
+
+namespace hackernewscmd {
+	ItemCache::ItemCache() :
+		mStats() {}
+
+	bool ItemCache::TryGet(StoryId id, CachedItem& item, bool& isFresh) {
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto it = mItems.find(id);
+		if (it == mItems.end()) {
+			++mStats.misses;
+			return false;
+		}
+		item = it->second;
+		auto now = std::time(nullptr);
+		isFresh = now - item.fetchTime < GetTimeToLive(now - item.storyTime);
+		if (isFresh) {
+			++mStats.hits;
+			mStats.bytesSaved += item.body.size();
+		} else {
+			++mStats.misses; // Until it's revalidated
+		}
+		return true;
+	}
+
+	void ItemCache::Put(StoryId id, CachedItem&& item) {
+		std::lock_guard<std::mutex> lock(mMutex);
+		mItems[id] = std::move(item);
+	}
+
+	void ItemCache::Revalidated(StoryId id, const CachedItem& item) {
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto it = mItems.find(id);
+		if (it != mItems.end()) {
+			it->second.fetchTime = std::time(nullptr);
+		}
+		--mStats.misses;
+		++mStats.revalidations;
+		mStats.bytesSaved += item.body.size();
+	}
+
+	void ItemCache::Evict(StoryId id) {
+		std::lock_guard<std::mutex> lock(mMutex);
+		mItems.erase(id);
+	}
+
+	ItemCacheStats ItemCache::GetStats() const {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mStats;
+	}
+
+	time_t ItemCache::GetTimeToLive(time_t storyAge) {
+		auto ttl = storyAge / kTtlDivisor;
+		return ttl < kMinTtl ? kMinTtl : ttl > kMaxTtl ? kMaxTtl : ttl;
+	}
+
+	// Entries are laid out as
+	// [id][fetch time][story time][etag][last modified][body],
+	// strings and the body being prefixed with their 32 bit length
+
+	template<typename T>
+	static bool ReadString(std::istream& stream, T& str) {
+		std::uint32_t length;
+		if (!stream.read(reinterpret_cast<char*>(&length), sizeof(length))) {
+			return false;
+		}
+		str.resize(length);
+		return length == 0 || stream.read(&str[0], length);
+	}
+
+	static void WriteString(std::ostream& stream, const char* str, std::size_t length) {
+		auto length32 = static_cast<std::uint32_t>(length);
+		stream.write(reinterpret_cast<const char*>(&length32), sizeof(length32));
+		stream.write(str, length32);
+	}
+
+	void ItemCache::Read(const std::string& filepath) {
+		std::ifstream stream(filepath, std::ifstream::binary);
+		if (!stream) {
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		StoryId id;
+		std::int64_t fetchTime, storyTime;
+		while (stream.read(reinterpret_cast<char*>(&id), sizeof(id))) {
+			CachedItem item;
+			if (!stream.read(reinterpret_cast<char*>(&fetchTime), sizeof(fetchTime))
+				|| !stream.read(reinterpret_cast<char*>(&storyTime), sizeof(storyTime))
+				|| !ReadString(stream, item.validators.etag)
+				|| !ReadString(stream, item.validators.lastModified)
+				|| !ReadString(stream, item.body)) {
+				break; // Truncated, keep what's been read so far
+			}
+			item.fetchTime = static_cast<time_t>(fetchTime);
+			item.storyTime = static_cast<time_t>(storyTime);
+			mItems[id] = std::move(item);
+		}
+	}
+
+	void ItemCache::Write(const std::string& filepath) {
+		std::ofstream stream(filepath, std::ofstream::binary | std::ofstream::trunc);
+		if (!stream) {
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto now = std::time(nullptr);
+		for (const auto& entry : mItems) {
+			const auto& item = entry.second;
+			if (now - item.fetchTime > kMaxEntryAge) {
+				continue;
+			}
+			auto fetchTime = static_cast<std::int64_t>(item.fetchTime);
+			auto storyTime = static_cast<std::int64_t>(item.storyTime);
+			stream.write(reinterpret_cast<const char*>(&entry.first), sizeof(entry.first));
+			stream.write(reinterpret_cast<const char*>(&fetchTime), sizeof(fetchTime));
+			stream.write(reinterpret_cast<const char*>(&storyTime), sizeof(storyTime));
+			WriteString(stream, item.validators.etag.data(), item.validators.etag.length());
+			WriteString(stream, item.validators.lastModified.data(), item.validators.lastModified.length());
+			WriteString(stream, item.body.data(), item.body.size());
+		}
+	}
+} // namespace hackernewscmd
\ No newline at end of file
@@ -0,0 +1,85 @@
+/**
+ * @file item_cache.h
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "story.h"
+#include "transport.h"
+
+
+namespace hackernewscmd {
+	/**
+	 * Raw item body along with what's needed to decide whether it can be
+	 * served as is, or revalidated with a conditional request
+	 */
+	struct CachedItem {
+		std::vector<char> body;
+		time_t fetchTime;
+		time_t storyTime;
+		Validators validators;
+	};
+
+	// Every lookup is one of these, a stale entry counting as a miss unless
+	// it's revalidated
+	struct ItemCacheStats {
+		unsigned long hits;
+		unsigned long revalidations;
+		unsigned long misses;
+		unsigned long long bytesSaved;
+	};
+
+	/**
+	 * Persistent cache of item bodies keyed by story id.
+	 * An entry stays fresh for longer the older its story is, since young
+	 * stories gather votes and comments quickly while old ones barely change.
+	 */
+	class ItemCache {
+	public:
+		ItemCache();
+
+		// Returns true if there's an entry; sets isFresh if it can be served
+		// without going to the network
+		bool TryGet(StoryId, CachedItem&, bool& isFresh);
+		void Put(StoryId, CachedItem&&);
+		// Marks an entry as still current after a not modified reply
+		void Revalidated(StoryId, const CachedItem&);
+		// Drops an entry whose body turned out to be unreadable
+		void Evict(StoryId);
+		ItemCacheStats GetStats() const;
+
+		void Read(const std::string&);
+		void Write(const std::string&);
+
+	private:
+		std::unordered_map<StoryId, CachedItem> mItems;
+		mutable std::mutex mMutex;
+		ItemCacheStats mStats;
+
+		static time_t GetTimeToLive(time_t);
+		static const time_t kTtlDivisor = 12;
+		static const time_t kMinTtl = 60;
+		static const time_t kMaxTtl = 6 * 60 * 60;
+		static const time_t kMaxEntryAge = 3 * 24 * 60 * 60;
+	}; // class ItemCache
+} // namespace hackernewscmd
\ No newline at end of file
@@ -0,0 +1,54 @@
+/**
+ * @file latency_tracker.cpp
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "latency_tracker.h"
+#include <algorithm>
+
+
+namespace hackernewscmd {
+	LatencyTracker::LatencyTracker() :
+		mNext(0) {
+		mSamples.reserve(kCapacity);
+	}
+
+	void LatencyTracker::Add(Clock::duration latency) {
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (mSamples.size() < kCapacity) {
+			mSamples.push_back(latency);
+		} else {
+			mSamples[mNext] = latency;
+		}
+		mNext = (mNext + 1) % kCapacity;
+	}
+
+	bool LatencyTracker::TryGetPercentile(unsigned percentile, Clock::duration& result) const {
+		std::vector<Clock::duration> samples;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (mSamples.size() < kMinSamples) {
+				return false;
+			}
+			samples = mSamples;
+		}
+		auto nth = samples.begin() + (samples.size() - 1) * percentile / 100;
+		std::nth_element(samples.begin(), nth, samples.end());
+		result = *nth;
+		return true;
+	}
+} // namespace hackernewscmd
\ No newline at end of file
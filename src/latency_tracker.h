@@ -0,0 +1,51 @@
+/**
+ * @file latency_tracker.h
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+
+namespace hackernewscmd {
+	/**
+	 * Keeps the latencies of the most recent requests, to answer percentile
+	 * queries about them.
+	 */
+	class LatencyTracker {
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		LatencyTracker();
+
+		void Add(Clock::duration);
+		// Fails while too few samples have been seen for the answer to mean much
+		bool TryGetPercentile(unsigned, Clock::duration&) const;
+
+	private:
+		mutable std::mutex mMutex;
+		std::vector<Clock::duration> mSamples;
+		std::size_t mNext;
+
+		static const std::size_t kCapacity = 256;
+		static const std::size_t kMinSamples = 20;
+	}; // class LatencyTracker
+} // namespace hackernewscmd
\ No newline at end of file
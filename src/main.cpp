@@ -21,33 +21,177 @@
 #include <stdlib.h>
 #include <crtdbg.h>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
+#include <string>
 #include "display_manager.h"
+#include "fetch_benchmark.h"
 #include "fetcher.h"
 #include "input_manager.h"
 #include "interact.h"
+#include "render_benchmark.h"
 #include "state_manager.h"
 #include "storage.h"
+#include "transport.h"
 
 namespace hn = hackernewscmd;
 
-int wmain(int, wchar_t*[])
+struct Options {
+	bool shouldPrintStats = false;
+	bool shouldUseEventLoop = false;
+	bool shouldBenchmark = false;
+	bool shouldStream = false;
+	bool shouldUseVirtualTerminal = false;
+	bool shouldBenchmarkRendering = false;
+	std::string host;
+	std::string recordPath;
+	std::string replayPath;
+	unsigned long replayLatencyMs = 0;
+};
+
+static std::string ToNarrow(const std::wstring& str) {
+	auto length = ::WideCharToMultiByte(CP_ACP, 0, str.c_str(), -1, NULL, 0, NULL, NULL);
+	std::string result(length, '\0');
+	::WideCharToMultiByte(CP_ACP, 0, str.c_str(), -1, &result[0], length, NULL, NULL);
+	result.resize(length - 1);
+	return result;
+}
+
+static Options ParseOptions(int argc, wchar_t* argv[]) {
+	Options options;
+	for (int i = 1; i < argc; ++i) {
+		std::wstring arg(argv[i]);
+		bool hasValue = i + 1 < argc;
+		if (arg == L"--stats") {
+			options.shouldPrintStats = true;
+		} else if (arg == L"--record" && hasValue) {
+			options.recordPath = ToNarrow(argv[++i]);
+		} else if (arg == L"--replay" && hasValue) {
+			options.replayPath = ToNarrow(argv[++i]);
+		} else if (arg == L"--latency" && hasValue) {
+			options.replayLatencyMs = std::stoul(argv[++i]);
+		} else if (arg == L"--host" && hasValue) {
+			options.host = ToNarrow(argv[++i]);
+		} else if (arg == L"--event-loop") {
+			options.shouldUseEventLoop = true;
+		} else if (arg == L"--benchmark") {
+			options.shouldBenchmark = true;
+		} else if (arg == L"--live") {
+			options.shouldStream = true;
+		} else if (arg == L"--render-benchmark") {
+			options.shouldBenchmarkRendering = true;
+		} else if (arg == L"--vt") {
+			options.shouldUseVirtualTerminal = true;
+		} else {
+			throw std::runtime_error("Unknown option " + ToNarrow(arg));
+		}
+	}
+	// A corpus holds no streams, so the subscription would only ever back off
+	if (options.shouldStream && !options.replayPath.empty()) {
+		throw std::runtime_error("--live can't be used with --replay");
+	}
+	return options;
+}
+
+int wmain(int argc, wchar_t* argv[])
 {
 	try {
+		auto options = ParseOptions(argc, argv);
+		if (options.shouldBenchmarkRendering) {
+			// Fails the run when drawing has grown costlier than its budget
+			return hn::RenderBenchmark().Run(std::wcout) ? 0 : 1;
+		}
+
+		auto endpoint = hn::Endpoint::Parse(options.host.empty() ? hn::NewsFetcher::kHost : options.host);
+
+		std::unique_ptr<hn::Transport> liveTransport, transport;
+		if (!options.replayPath.empty()) {
+			transport = std::make_unique<hn::ReplayTransport>(options.replayPath, options.replayLatencyMs);
+		} else {
+			liveTransport = std::make_unique<hn::LiveTransport>(endpoint);
+			if (!options.recordPath.empty()) {
+				transport = std::make_unique<hn::RecordingTransport>(*liveTransport, options.recordPath);
+			}
+		}
+
+		auto& activeTransport = transport ? *transport : *liveTransport;
+
+		if (options.shouldBenchmark) {
+			hn::FetchBenchmark(activeTransport).Run(std::wcout);
+			return 0;
+		}
+
+		// Fetches through the same transport, so replays and recordings
+		// cover the event loop too
+		std::unique_ptr<hn::FetchSession> eventLoop;
+		if (options.shouldUseEventLoop) {
+			eventLoop = activeTransport.OpenFetchSession();
+		}
+
+		if (options.shouldUseVirtualTerminal) {
+			hn::Interact::SetTerminalType(hn::TerminalType::Virtual);
+		}
 		auto& interact = hn::Interact::GetInstance();
 		auto& stateManager = hn::StateManager::GetInstance();
 		hn::InputManager inputManager(interact, stateManager);
-		hn::NewsFetcher newsFetcher;
 		auto& storage = hn::Storage::GetInstance();
-		hn::DisplayManager displayManager(interact);
+		// Recordings must see every item and replays must not depend on, or
+		// write to, whatever the local cache happens to hold
+		auto itemCache = options.recordPath.empty() && options.replayPath.empty() ? storage.GetItemCache() : nullptr;
+		hn::NewsFetcher newsFetcher(activeTransport, itemCache, eventLoop.get());
+		hn::DisplayManager displayManager(interact, newsFetcher.GetHosts());
 
 		stateManager.Init(storage, newsFetcher, displayManager);
 
 		inputManager.Go();
 		stateManager.Start();
+		if (options.shouldStream) {
+			stateManager.SubscribeToTopStories();
+		}
 
 		inputManager.Wait();
-	} catch (const std::runtime_error& e) {
+
+		if (options.shouldPrintStats) {
+			auto stats = newsFetcher.GetConnectionStats();
+			std::wcerr << L"requests: " << stats.requests
+				<< L", connections: " << stats.connections
+				// A connection opened for a request that failed was never reused
+				<< L", reused: " << (stats.requests > stats.connections ? stats.requests - stats.connections : 0)
+				<< L", concurrency limit: " << newsFetcher.GetConcurrencyLimit() << std::endl;
+			if (itemCache != nullptr) {
+				auto cacheStats = itemCache->GetStats();
+				std::wcerr << L"cache hits: " << cacheStats.hits
+					<< L", revalidated: " << cacheStats.revalidations
+					<< L", misses: " << cacheStats.misses
+					<< L", bytes saved: " << cacheStats.bytesSaved << std::endl;
+			}
+			auto retryStats = newsFetcher.GetRetryStats();
+			std::wcerr << L"retries: " << retryStats.retries
+				<< L", hedges: " << retryStats.hedges
+				<< L", hedges won: " << retryStats.hedgesWon
+				<< L", coalesced: " << newsFetcher.GetCoalescedCount() << std::endl;
+			auto storageStats = newsFetcher.GetStoryStorageStats();
+			std::wcerr << L"story strings: " << stateManager.GetStoryStringBytes()
+				<< L" bytes, interned: " << storageStats.bytes
+				<< L" bytes, authors: " << storageStats.authors
+				<< L", hosts: " << storageStats.hosts << std::endl;
+			auto prefetchStats = stateManager.GetPrefetchStats();
+			std::wcerr << L"prefetch hits: " << prefetchStats.hits
+				<< L", misses: " << prefetchStats.misses << std::endl;
+			auto renderStats = interact.GetRenderStats();
+			std::wcerr << L"frames drawn: " << renderStats.frames
+				<< L", console calls: " << renderStats.consoleCalls;
+			if (renderStats.frames > 0) {
+				std::wcerr << L" (" << renderStats.consoleCalls / renderStats.frames << L" per frame)";
+			}
+			std::wcerr << std::endl;
+			if (options.shouldStream) {
+				auto subscriptionStats = stateManager.GetSubscriptionStats();
+				std::wcerr << L"list updates streamed: " << subscriptionStats.updates
+					<< L", stream reconnects: " << subscriptionStats.reconnects << std::endl;
+			}
+		}
+	} catch (const std::exception& e) {
 		std::cerr << e.what() << std::endl;
 	}
 
@@ -0,0 +1,94 @@
+/**
+ * @file mpsc_queue.h
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+
+namespace hackernewscmd {
+	/**
+	 * Lock-free queue with many producers and a single consumer.
+	 * Producers push onto a list with a compare and swap. The consumer takes
+	 * the whole list in one exchange and hands it out oldest first, so
+	 * there is nothing to contend on but the head, and no ABA since nodes
+	 * are never taken one at a time.
+	 */
+	template<typename T>
+	class MpscQueue {
+	public:
+		MpscQueue() : mHead(nullptr) {};
+		~MpscQueue() {
+			Drain([](T&) {});
+		}
+		MpscQueue(const MpscQueue&) = delete;
+		MpscQueue& operator=(const MpscQueue&) = delete;
+
+		// From any thread. Returns true if the queue was empty, in which case
+		// the pusher is the one to wake the consumer.
+		bool Push(T value) {
+			auto node = new Node(std::move(value));
+			auto head = mHead.load(std::memory_order_relaxed);
+			do {
+				node->next = head;
+			} while (!mHead.compare_exchange_weak(head, node));
+			return head == nullptr;
+		}
+
+		bool IsEmpty() const {
+			return mHead.load() == nullptr;
+		}
+
+		// From the consumer only. Hands everything pushed so far to the
+		// handler, in the order it was pushed, and returns how many there were.
+		template<typename Handler>
+		std::size_t Drain(Handler handler) {
+			Node* node = mHead.exchange(nullptr, std::memory_order_acquire);
+			Node* oldest = nullptr;
+			while (node != nullptr) {
+				auto next = node->next;
+				node->next = oldest;
+				oldest = node;
+				node = next;
+			}
+
+			std::size_t count = 0;
+			while (oldest != nullptr) {
+				std::unique_ptr<Node> current(oldest);
+				oldest = oldest->next;
+				handler(current->value);
+				++count;
+			}
+			return count;
+		}
+
+	private:
+		struct Node {
+			explicit Node(T&& v) : value(std::move(v)), next(nullptr) {};
+
+			T value;
+			Node* next;
+		};
+
+		std::atomic<Node*> mHead;
+	}; // class MpscQueue
+} // namespace hackernewscmd
\ No newline at end of file
@@ -0,0 +1,65 @@
+/**
+ * @file prefetch_policy.cpp
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "prefetch_policy.h"
+
+
+namespace hackernewscmd {
+	const PrefetchPolicy::Clock::duration PrefetchPolicy::kQuickTurn = std::chrono::seconds(2);
+
+	PrefetchPolicy::PrefetchPolicy() :
+		mDirection(1),
+		mStreak(0),
+		mIsSkimming(false),
+		mStats() {}
+
+	void PrefetchPolicy::OnPageTurn(const long fromPage, const long toPage, const bool isSkimming, const bool wasLoaded) {
+		++(wasLoaded ? mStats.hits : mStats.misses);
+
+		auto direction = toPage < fromPage ? -1L : 1L;
+		auto now = Clock::now();
+		if (direction == mDirection && now - mLastTurn < kQuickTurn) {
+			++mStreak;
+		} else {
+			mStreak = 0;
+		}
+		mDirection = direction;
+		mIsSkimming = isSkimming;
+		mLastTurn = now;
+	}
+
+	long PrefetchPolicy::GetFirstPage(const long page) const {
+		return page - (mDirection < 0 ? static_cast<long>(GetPagesAhead()) : 1L);
+	}
+
+	long PrefetchPolicy::GetLastPage(const long page) const {
+		return page + (mDirection > 0 ? static_cast<long>(GetPagesAhead()) : 1L);
+	}
+
+	PrefetchStats PrefetchPolicy::GetStats() const {
+		return mStats;
+	}
+
+	unsigned PrefetchPolicy::GetPagesAhead() const {
+		if (mIsSkimming) {
+			return kMaxPagesAhead;
+		}
+		return mStreak + 1 < kMaxPagesAhead ? mStreak + 1 : static_cast<unsigned>(kMaxPagesAhead);
+	}
+} // namespace hackernewscmd
\ No newline at end of file
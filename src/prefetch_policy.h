@@ -0,0 +1,64 @@
+/**
+ * @file prefetch_policy.h
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <chrono>
+
+
+namespace hackernewscmd {
+	/**
+	 * Page turns that found the page already loaded, and ones that didn't
+	 */
+	struct PrefetchStats {
+		unsigned long hits;
+		unsigned long misses;
+	};
+
+	/**
+	 * Decides which pages around the current one to keep loaded, from the
+	 * direction and pace of page turns. One page is kept behind; the pages
+	 * kept ahead grow with every quick turn in the same direction, and go to
+	 * the most there are while skimming with skips.
+	 */
+	class PrefetchPolicy {
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		PrefetchPolicy();
+
+		void OnPageTurn(const long, const long, const bool, const bool);
+		// The window of pages to keep loaded around the given page
+		long GetFirstPage(const long) const;
+		long GetLastPage(const long) const;
+		PrefetchStats GetStats() const;
+
+	private:
+		long mDirection;
+		unsigned mStreak;
+		bool mIsSkimming;
+		Clock::time_point mLastTurn;
+		PrefetchStats mStats;
+
+		static const unsigned kMaxPagesAhead = 5;
+		static const Clock::duration kQuickTurn;
+
+		unsigned GetPagesAhead() const;
+	}; // class PrefetchPolicy
+} // namespace hackernewscmd
\ No newline at end of file
@@ -0,0 +1,283 @@
+/**
+ * @file render_benchmark.cpp
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "render_benchmark.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#undef min
+#undef max
+
+
+namespace hackernewscmd {
+	RenderBenchmark::RenderBenchmark() :
+		mHosts(mHostArena),
+		mStories(kStoryCount),
+		mTerminal(nullptr),
+		mIsDisplayRunning(false) {
+		auto terminal = std::unique_ptr<RecordingTerminal>(new RecordingTerminal(kColumns, kRows));
+		mTerminal = terminal.get();
+		mInteract = Interact::CreateHeadless(std::move(terminal));
+		mDisplayManager = std::make_unique<DisplayManager>(*mInteract, mHosts);
+		AddStories();
+	}
+
+	RenderBenchmark::~RenderBenchmark() {
+		if (mIsDisplayRunning) {
+			DisplayCommand quit = {};
+			quit.action = DisplayCommand::Quit;
+			Send({ quit });
+			mDisplayManager->Wait();
+		}
+	}
+
+	bool RenderBenchmark::Run(std::wostream& out) {
+		// The first page, as the client comes up
+		mDisplayManager->Go(mDisplayCV, mDisplayMutex, mDisplayChannel, mStories);
+		mIsDisplayRunning = true;
+		Send({ PageCommand(0) });
+		WaitUntilIdle();
+
+		// One blit, asking where the window is and moving it. Up to three
+		// lines of title and one of addendum a story, a blank after each and
+		// the footer; and the rows of two stories. A held key's run is blitted
+		// as one rectangle from the story it starts on to the one it ends on,
+		// so may span the page.
+		const Budget pageBudget = { 3, static_cast<unsigned long>(kColumns * (kPageSize * 5 + 1)) };
+		const Budget selectionBudget = { 3, static_cast<unsigned long>(kColumns * 8) };
+		auto isWithinBudget = true;
+
+		Script pageTurns;
+		for (std::size_t page = 1; page < kLoadedPages; ++page) {
+			pageTurns.push_back([this, page]() { Send({ PageCommand(page) }); });
+		}
+		for (auto page = kLoadedPages - 1; page-- > 0;) {
+			pageTurns.push_back([this, page]() { Send({ PageCommand(page) }); });
+		}
+		isWithinBudget = Report(out, L"page turns", Measure(pageTurns), pageBudget) && isWithinBudget;
+
+		Script selections;
+		for (std::size_t index = 1; index < kPageSize; ++index) {
+			selections.push_back([this, index]() { Send({ SelectionCommand(index) }); });
+		}
+		for (auto index = kPageSize - 1; index-- > 0;) {
+			selections.push_back([this, index]() { Send({ SelectionCommand(index) }); });
+		}
+		isWithinBudget = Report(out, L"selections", Measure(selections), selectionBudget) && isWithinBudget;
+
+		// Held keys, each run drawn as one
+		Script heldSelections;
+		heldSelections.push_back([this]() {
+			std::vector<DisplayCommand> commands;
+			for (std::size_t index = 1; index < kPageSize; ++index) {
+				commands.push_back(SelectionCommand(index));
+			}
+			Send(commands);
+		});
+		heldSelections.push_back([this]() {
+			std::vector<DisplayCommand> commands;
+			for (auto index = kPageSize - 1; index-- > 0;) {
+				commands.push_back(SelectionCommand(index));
+			}
+			Send(commands);
+		});
+		isWithinBudget = Report(out, L"held selections", Measure(heldSelections), pageBudget) && isWithinBudget;
+
+		Script skippedPages;
+		skippedPages.push_back([this]() {
+			std::vector<DisplayCommand> commands;
+			for (std::size_t page = 1; page < kLoadedPages; ++page) {
+				commands.push_back(PageCommand(page));
+			}
+			Send(commands);
+		});
+		skippedPages.push_back([this]() {
+			std::vector<DisplayCommand> commands;
+			for (auto page = kLoadedPages - 1; page-- > 0;) {
+				commands.push_back(PageCommand(page));
+			}
+			Send(commands);
+		});
+		isWithinBudget = Report(out, L"held page skips", Measure(skippedPages), pageBudget) && isWithinBudget;
+
+		// A page that hasn't loaded comes up with placeholders, its stories
+		// landing last first
+		Script loadingPage;
+		loadingPage.push_back([this]() { Send({ PageCommand(kLoadedPages) }); });
+		for (auto index = kStoryCount; index-- > kPageSize * kLoadedPages;) {
+			loadingPage.push_back([this, index]() { PublishCompletion(index); });
+		}
+		isWithinBudget = Report(out, L"out of order loads", Measure(loadingPage), pageBudget) && isWithinBudget;
+
+		// Every story is kept, so every refresh should leave the strings
+		// taking what they took before
+		Script refreshes;
+		auto storyBytes = mStories.GetArena()->GetSize();
+		auto isMemoryFlat = true;
+		for (auto refresh = 0; refresh < kRefreshes; ++refresh) {
+			refreshes.push_back([this, storyBytes, &isMemoryFlat]() {
+				std::weak_ptr<StringArena> retired = mStories.GetArena();
+				Refresh();
+				isMemoryFlat = isMemoryFlat && retired.expired() && mStories.GetArena()->GetSize() <= storyBytes;
+				Send({ PageCommand(0) });
+			});
+		}
+		isWithinBudget = Report(out, L"refreshes", Measure(refreshes), pageBudget) && isWithinBudget;
+		out << L"story strings: " << storyBytes << L" bytes before refreshing, "
+			<< mStories.GetArena()->GetSize() << L" after";
+		if (!isMemoryFlat) {
+			out << L" -- grown, or an old list's strings kept";
+		}
+		out << std::endl;
+		isWithinBudget = isMemoryFlat && isWithinBudget;
+
+		auto stats = mInteract->GetRenderStats();
+		out << L"frames: " << stats.frames << L", console calls: " << stats.consoleCalls
+			<< L", cells written: " << mTerminal->GetCellsWritten()
+			<< L", primitives logged: " << mTerminal->GetLog().size() << std::endl;
+		return isWithinBudget;
+	}
+
+	void RenderBenchmark::AddStories() {
+		const std::string words = "a story with a title of some length about rendering, terminals and the cost of drawing them ";
+		const char* hosts[] = { "example.com", "news.example.org", "blog.example.net" };
+		for (std::size_t index = 0; index < kStoryCount; ++index) {
+			mStories.Append(1000 + index);
+
+			// Titles from a fraction of a line to a couple of lines long
+			std::string title = "Story " + std::to_string(index) + ": ";
+			auto length = 20 + index * 37 % 130;
+			while (title.length() < length) {
+				title += words;
+			}
+			title.resize(length);
+
+			Story story;
+			story.id = 1000 + index;
+			story.title = mStories.GetArena()->Store(title.c_str(), title.length());
+			story.score = index * 7 % 500;
+			story.descendants = index * 13 % 300;
+			story.host = mHosts.Intern(hosts[index % 3], std::strlen(hosts[index % 3]));
+			if (index < kPageSize * kLoadedPages) {
+				StoryCompletion completion = { story, index, mStories.GetGeneration(), StoryLoadStatus::Completed };
+				mStories.Publish(completion);
+			} else {
+				mLoadingStories.push_back(story);
+			}
+		}
+	}
+
+	DisplayCommand RenderBenchmark::PageCommand(std::size_t page) const {
+		DisplayCommand command = {};
+		command.action = DisplayCommand::DisplayPage;
+		command.page.stories = &mStories;
+		command.page.begin = page * kPageSize;
+		command.page.end = std::min(command.page.begin + kPageSize, mStories.GetSize());
+		command.page.currentPage = page + 1;
+		command.page.totalPages = (mStories.GetSize() - 1) / kPageSize;
+		return command;
+	}
+
+	DisplayCommand RenderBenchmark::SelectionCommand(std::size_t index) const {
+		DisplayCommand command = {};
+		command.action = DisplayCommand::SelectStory;
+		command.story = &mStories.GetStory(index);
+		return command;
+	}
+
+	RenderBenchmark::Result RenderBenchmark::Measure(const Script& script) {
+		Result result = {};
+		for (const auto& action : script) {
+			auto calls = mTerminal->GetCallCount();
+			auto cellsWritten = mTerminal->GetCellsWritten();
+			auto start = std::chrono::steady_clock::now();
+			action();
+			WaitUntilIdle();
+			result.elapsed += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+			calls = mTerminal->GetCallCount() - calls;
+			cellsWritten = mTerminal->GetCellsWritten() - cellsWritten;
+			result.calls += calls;
+			result.cellsWritten += cellsWritten;
+			result.maxCalls = std::max(result.maxCalls, calls);
+			result.maxCellsWritten = std::max(result.maxCellsWritten, cellsWritten);
+		}
+		result.actions = script.size();
+		return result;
+	}
+
+	void RenderBenchmark::Send(const std::vector<DisplayCommand>& commands) {
+		// The display thread only lets go of the mutex to wait, so it can't
+		// pick up any of the commands before all of them are in
+		std::lock_guard<std::mutex> lock(mDisplayMutex);
+		for (const auto& command : commands) {
+			if (!mDisplayChannel.commands.TryPush(command)) {
+				throw std::runtime_error("Too many display commands at once");
+			}
+		}
+		mDisplayCV.notify_all();
+	}
+
+	void RenderBenchmark::WaitUntilIdle() {
+		for (;;) {
+			{
+				// Holding the mutex, a display thread that says it's waiting is
+				// waiting
+				std::lock_guard<std::mutex> lock(mDisplayMutex);
+				if (mDisplayChannel.isConsumerWaiting
+					&& mDisplayChannel.commands.IsEmpty()
+					&& mDisplayChannel.completions.IsEmpty()) {
+					return;
+				}
+			}
+			std::this_thread::yield();
+		}
+	}
+
+	void RenderBenchmark::PublishCompletion(std::size_t index) {
+		StoryCompletion completion = { mLoadingStories[index - kPageSize * kLoadedPages], index, mStories.GetGeneration(), StoryLoadStatus::Completed };
+		std::lock_guard<std::mutex> lock(mDisplayMutex);
+		mDisplayChannel.completions.Push(std::move(completion));
+		mDisplayCV.notify_all();
+	}
+
+	void RenderBenchmark::Refresh() {
+		auto ids = mStories.GetIds();
+		std::rotate(ids.begin(), ids.begin() + 1, ids.end());
+		auto diff = StoryListDiff::Compute(mStories.GetIds(), ids);
+		std::lock_guard<std::mutex> lock(mDisplayMutex);
+		mStories.Rearrange(diff, ids);
+	}
+
+	bool RenderBenchmark::Report(std::wostream& out, const std::wstring& scenario, const Result& result, const Budget& budget) const {
+		auto actions = std::max(result.actions, std::size_t(1));
+		out << scenario << L": " << result.actions << L" actions, per action "
+			<< result.calls / actions << L" calls (at most " << result.maxCalls << L"), "
+			<< result.cellsWritten / actions << L" cells written (at most " << result.maxCellsWritten << L"), "
+			<< result.elapsed.count() / actions << L" us";
+		auto isWithinBudget = result.maxCalls <= budget.calls && result.maxCellsWritten <= budget.cellsWritten;
+		if (!isWithinBudget) {
+			out << L" -- over budget of " << budget.calls << L" calls, " << budget.cellsWritten << L" cells";
+		}
+		out << std::endl;
+		return isWithinBudget;
+	}
+} // namespace hackernewscmd
\ No newline at end of file
@@ -0,0 +1,109 @@
+/**
+ * @file render_benchmark.h
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "display_manager.h"
+#include "interact.h"
+#include "story.h"
+#include "story_buffer.h"
+#include "string_arena.h"
+#include "terminal.h"
+
+
+namespace hackernewscmd {
+	/**
+	 * Replays scripted navigation on a display drawing to a recording
+	 * terminal, and reports what each action cost on screen: cells written,
+	 * console calls and time taken. Each scenario has a budget per action,
+	 * and Run returns false if any went over it, so that a rendering
+	 * regression fails the run rather than showing up as flicker.
+	 * Commands are handed over the way StateManager does, an action's worth
+	 * at a time, as if its keys came faster than they could be drawn.
+	 * Refreshes also check that the list's strings take no more memory
+	 * than before, the arena of the list replaced having been freed.
+	 */
+	class RenderBenchmark {
+	public:
+		RenderBenchmark();
+		~RenderBenchmark();
+		RenderBenchmark(const RenderBenchmark&) = delete;
+		RenderBenchmark& operator=(const RenderBenchmark&) = delete;
+
+		bool Run(std::wostream&);
+
+	private:
+		// What an action may cost at most
+		struct Budget {
+			unsigned long calls;
+			unsigned long cellsWritten;
+		};
+
+		struct Result {
+			std::size_t actions;
+			unsigned long calls;
+			unsigned long cellsWritten;
+			unsigned long maxCalls;
+			unsigned long maxCellsWritten;
+			std::chrono::microseconds elapsed;
+		};
+
+		using Script = std::vector<std::function<void()>>;
+
+		StringArena mHostArena;
+		StringTable mHosts;
+		StoryBuffer mStories;
+		RecordingTerminal* mTerminal; // Owned by the display's Interact
+		std::unique_ptr<Interact> mInteract;
+		std::unique_ptr<DisplayManager> mDisplayManager;
+		std::condition_variable mDisplayCV;
+		std::mutex mDisplayMutex;
+		DisplayChannel mDisplayChannel;
+		bool mIsDisplayRunning;
+		std::vector<Story> mLoadingStories; // The last page's, landing as the script goes
+
+		void AddStories();
+		DisplayCommand PageCommand(std::size_t) const;
+		DisplayCommand SelectionCommand(std::size_t) const;
+		Result Measure(const Script&);
+		// Hands over the commands in one go, with the display thread held
+		void Send(const std::vector<DisplayCommand>&);
+		void WaitUntilIdle();
+		void PublishCompletion(std::size_t);
+		// Rearranges the list, every story moving up one place
+		void Refresh();
+		bool Report(std::wostream&, const std::wstring&, const Result&, const Budget&) const;
+
+		static const short kColumns = 80;
+		static const short kRows = 25;
+		static const std::size_t kPageSize = 10;
+		static const std::size_t kLoadedPages = 6;
+		static const std::size_t kStoryCount = kPageSize * (kLoadedPages + 1); // The last page is left to load
+		static const int kRefreshes = 10;
+	}; // class RenderBenchmark
+} // namespace hackernewscmd
\ No newline at end of file
@@ -0,0 +1,115 @@
+/**
+ * @file ring_buffer.h
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+
+namespace hackernewscmd {
+	/**
+	 * Bounded lock-free queue over a ring of cells, each stamped with a
+	 * sequence number that says whether it's free for the producer at that
+	 * position or full for the consumer at that position. A position is
+	 * claimed with a compare and swap, and the cell is handed over by
+	 * releasing its new stamp, so neither side ever waits on the other.
+	 * Safe for any number of producers and consumers.
+	 */
+	template<typename T>
+	class RingBuffer {
+	public:
+		// The capacity must be a power of two
+		explicit RingBuffer(std::size_t capacity) :
+			mCells(new Cell[capacity]),
+			mMask(capacity - 1),
+			mEnqueuePosition(0),
+			mDequeuePosition(0) {
+			if (capacity < 2 || (capacity & mMask) != 0) {
+				throw std::runtime_error("Ring capacity must be a power of two");
+			}
+			for (std::size_t position = 0; position < capacity; ++position) {
+				mCells[position].sequence.store(position, std::memory_order_relaxed);
+			}
+		}
+		RingBuffer(const RingBuffer&) = delete;
+		RingBuffer& operator=(const RingBuffer&) = delete;
+
+		// Returns false, and leaves the ring alone, when it's full
+		bool TryPush(const T& value) {
+			auto position = mEnqueuePosition.load(std::memory_order_relaxed);
+			for (;;) {
+				auto& cell = mCells[position & mMask];
+				auto sequence = cell.sequence.load(std::memory_order_acquire);
+				auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+				if (difference == 0) {
+					if (mEnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+						cell.value = value;
+						cell.sequence.store(position + 1, std::memory_order_release);
+						return true;
+					}
+				} else if (difference < 0) {
+					return false;
+				} else {
+					position = mEnqueuePosition.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		// Returns false when it's empty
+		bool TryPop(T& value) {
+			auto position = mDequeuePosition.load(std::memory_order_relaxed);
+			for (;;) {
+				auto& cell = mCells[position & mMask];
+				auto sequence = cell.sequence.load(std::memory_order_acquire);
+				auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position + 1);
+				if (difference == 0) {
+					if (mDequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+						value = cell.value;
+						cell.sequence.store(position + mMask + 1, std::memory_order_release);
+						return true;
+					}
+				} else if (difference < 0) {
+					return false;
+				} else {
+					position = mDequeuePosition.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		bool IsEmpty() const {
+			auto position = mDequeuePosition.load();
+			return mCells[position & mMask].sequence.load() != position + 1;
+		}
+
+	private:
+		struct Cell {
+			std::atomic<std::size_t> sequence;
+			T value;
+		};
+
+		const std::unique_ptr<Cell[]> mCells;
+		const std::size_t mMask;
+		std::atomic<std::size_t> mEnqueuePosition;
+		std::atomic<std::size_t> mDequeuePosition;
+	}; // class RingBuffer
+} // namespace hackernewscmd
\ No newline at end of file
@@ -22,9 +22,13 @@
 #include <chrono>
 #include <future>
 #include <stdexcept>
+#include <thread>
 #include <utility>
+#include "encoding.h"
+#include "story_list_diff.h"
 
 #undef min
+#undef max
 
 
 namespace hackernewscmd {
@@ -32,11 +36,9 @@ namespace hackernewscmd {
 		mCurrentDisplayPage(-1),
 		mCurrentSelectedStoryIndex(0),
 		mIsInited(false),
+		mStories(kMaxTopStories),
 		mSkippedStories(nullptr),
-		mDisplayMutex(std::mutex()),
-		mDisplayLock(mDisplayMutex, std::defer_lock),
-		mDisplayReverseMutex(std::mutex()),
-		mDisplayReverseLock(mDisplayReverseMutex, std::defer_lock) {};
+		mSubscriptionStats() {};
 
 	void StateManager::Init(Storage& storage, NewsFetcher& fetcher, DisplayManager& dispManager) {
 		mStorage = &storage;
@@ -51,127 +53,238 @@ namespace hackernewscmd {
 		}
 
 		auto loadFromStorage = std::async(&StateManager::LoadFromStorage, this);
-		auto loadTopStories = std::async(&StateManager::FetchTopStories, this);
-		loadFromStorage.wait();
-		loadTopStories.wait();
-		DiffTopStories();
 
-		mPagedDisplayBuffer.resize(mTopStories.size());
-		for (std::size_t i = 0; i < mTopStories.size(); ++i) {
-			mPagedDisplayBuffer[i].first.id = mTopStories[i];
-		}
+		// Stream the top stories list in, and get the first page's stories
+		// going as soon as their ids are known. The buffer has room for the
+		// longest possible list up front so that slots being filled in by the
+		// fetcher never move.
+		std::unordered_set<StoryId> stillSkippedStories;
+		PageIndices indices;
+		bool isFirstPageFetched = false;
+		mFetcher->FetchTopStoryIds([&](StoryId id) {
+			loadFromStorage.wait();
+			if (mSkippedStories->find(id) != mSkippedStories->end()) {
+				stillSkippedStories.insert(id);
+				return;
+			}
+			if (mStories.IsFull()) {
+				return;
+			}
+			mStories.Append(id);
+			if (mStories.GetSize() == kDisplayPageSize) {
+				// The rest of the list keeps streaming while the page loads
+				FetchPage(0, FetchPriority::Visible);
+				isFirstPageFetched = true;
+			}
+		});
+		loadFromStorage.wait();
+		// Skipped stories that have dropped off the list needn't be remembered
+		mSkippedStories->swap(stillSkippedStories);
 
 		mCurrentDisplayPage = 0;
 		mCurrentSelectedStoryIndex = 0;
 
-		PageIndices indices;
 		TryGetIndicesForDisplayPage(0, indices); // First page, no need to check for result
-		FetchDisplayPage(indices);
+		if (!isFirstPageFetched) {
+			FetchPage(0, FetchPriority::Visible);
+		}
+		FetchPrefetchWindow(0);
 
-		SetupDisplayThreadDataForPageDisplay(indices, 1);
-		mDisplayPageData.totalPages = (mTopStories.size() - 1) / kDisplayPageSize;
-		mDisplayManager->Go(mDisplayCV, *(mDisplayLock.mutex()), mDisplayThreadData, mDisplayReverseCV);
+		DisplayPage(indices, 0);
+		mDisplayManager->Go(mDisplayCV, mDisplayMutex, mDisplayChannel, mStories);
 	}
 
-	void StateManager::GotoNextPage(bool skipCurr) {
-		GotoPage(mCurrentDisplayPage + 1, skipCurr);
-	}
+	void StateManager::MoveSelection(long distance, long skipBegin, long skipEnd) {
+		if (mStories.GetSize() == 0) {
+			return;
+		}
+		auto current = static_cast<long>(mCurrentSelectedStoryIndex);
+		for (auto position = skipBegin; position < skipEnd; ++position) {
+			if (current + position >= 0) {
+				SkipStory(current + position);
+			}
+		}
 
-	void StateManager::GotoPrevPage(bool skipCurr) {
-		GotoPage(mCurrentDisplayPage - 1, skipCurr);
+		// Moving past either end stops there
+		auto last = static_cast<long>(mStories.GetSize()) - 1;
+		auto index = std::max(0L, std::min(current + distance, last));
+		if (index != current) {
+			SelectStory(index);
+		}
 	}
 
-	void StateManager::SelectNextStory(bool skipCurr) {
-		SelectStory(mCurrentSelectedStoryIndex + 1, skipCurr);
-	}
+	void StateManager::TurnPages(long distance, long skipBegin, long skipEnd) {
+		if (mStories.GetSize() == 0) {
+			return;
+		}
+		PageIndices indices;
+		for (auto position = skipBegin; position < skipEnd; ++position) {
+			if (mCurrentDisplayPage + position >= 0 && TryGetIndicesForDisplayPage(mCurrentDisplayPage + position, indices)) {
+				for (auto index = indices.first; index < indices.second; ++index) {
+					SkipStory(index);
+				}
+			}
+		}
 
-	void StateManager::SelectPrevStory(bool skipCurr) {
-		SelectStory(mCurrentSelectedStoryIndex - 1, skipCurr);
+		auto lastPage = static_cast<long>((mStories.GetSize() - 1) / kDisplayPageSize);
+		auto page = std::max(0L, std::min(mCurrentDisplayPage + distance, lastPage));
+		if (page != mCurrentDisplayPage) {
+			GotoPage(page, skipBegin != skipEnd);
+		}
 	}
 
 	void StateManager::OpenSelectedStory(bool shouldOpenComments) {
-		const wchar_t* url = nullptr;
-		std::wstring urlComments;
+		std::wstring url;
 
-		auto& story = mPagedDisplayBuffer[mCurrentSelectedStoryIndex].first;
-		if (!shouldOpenComments && story.url.length()) {
-			url = story.url.c_str();
+		auto& story = mStories.GetStory(mCurrentSelectedStoryIndex);
+		if (!shouldOpenComments && !story.url.IsEmpty()) {
+			url = Utf8ToWide(story.url.data, story.url.length);
 		} else {
-			urlComments = GetStoryPageUrl(story);
-			url = urlComments.c_str();
+			url = GetStoryPageUrl(story);
 		}
-		if (reinterpret_cast<int>(::ShellExecuteW(NULL, NULL, url, NULL, NULL, SW_SHOWNORMAL)) <= 32) {
+		if (reinterpret_cast<int>(::ShellExecuteW(NULL, NULL, url.c_str(), NULL, NULL, SW_SHOWNORMAL)) <= 32) {
 			throw std::runtime_error("Couldn't open browser");
 		}
 
 		if (!shouldOpenComments) {
-			mSkippedStories->insert(story.id);
+			SkipStory(mCurrentSelectedStoryIndex);
 		}
 	}
 
 	void StateManager::Quit() {
-		mDisplayLock.lock();
-		mDisplayThreadData.redo = true;
-		mDisplayThreadData.action = DisplayThreadData::Quit;
-		mDisplayLock.unlock();
-		mDisplayCV.notify_all();
+		if (mSubscription != nullptr) {
+			mSubscriptionStats = mSubscription->GetStats();
+			mSubscription.reset();
+		}
+		DisplayCommand command = {};
+		command.action = DisplayCommand::Quit;
+		PushCommand(command);
 		mDisplayManager->Wait();
 	}
 
-	std::unique_ptr<StateManager> StateManager::mInstance = nullptr;
-	StateManager& StateManager::GetInstance() {
-		if (mInstance == nullptr) {
-			mInstance = std::make_unique<StateManager>(Key{});
+	void StateManager::RefreshStories() {
+		// Downloaded off this thread, so keys are still handled meanwhile,
+		// and taken in like a list that's been streamed
+		try {
+			mFetcher->FetchTopStoryIdsAsync(std::bind(&StateManager::OnTopStoriesStreamed, this, std::placeholders::_1));
+		} catch (const std::runtime_error&) {
+			// Keep showing what we have
 		}
-		return *mInstance;
 	}
 
-	void StateManager::LoadFromStorage() {
-		mSkippedStories = mStorage->GetSkippedStoryIds();
+	void StateManager::SubscribeToTopStories() {
+		mSubscription = mFetcher->SubscribeTopStoryIds(std::bind(&StateManager::OnTopStoriesStreamed, this, std::placeholders::_1));
 	}
 
-	void StateManager::FetchTopStories() {
-		mTopStories = mFetcher->FetchTopStoryIds();
+	void StateManager::OnTopStoriesStreamed(std::vector<StoryId> topStories) {
+		{
+			// Lists streamed in faster than they're taken in replace each other
+			std::lock_guard<std::mutex> lock(mStreamedTopStoriesMutex);
+			mStreamedTopStories = std::move(topStories);
+		}
+		Interact::GetInstance().PostAction(InputAction::UpdateStories);
 	}
 
-	void StateManager::DiffTopStories() {
-		decltype(mTopStories) newTopStories;
-		std::unordered_set<StoryId> newSkippedStories;
-		for (const auto& story : mTopStories) {
-			if (mSkippedStories->find(story) == mSkippedStories->end()) {
-				newTopStories.emplace_back(story);
-			} else {
-				newSkippedStories.insert(story);
-			}
+	void StateManager::ApplyStreamedTopStories() {
+		std::vector<StoryId> topStories;
+		{
+			std::lock_guard<std::mutex> lock(mStreamedTopStoriesMutex);
+			topStories.swap(mStreamedTopStories);
+		}
+		if (!topStories.empty()) {
+			ReplaceTopStories(topStories);
 		}
-		mTopStories.swap(newTopStories);
-		mSkippedStories->swap(newSkippedStories);
 	}
 
-	void StateManager::GotoPage(const long page, const bool skipCurr) {
+	void StateManager::ReplaceTopStories(const std::vector<StoryId>& ids) {
+		std::vector<StoryId> topStories;
+		std::unordered_set<StoryId> stillSkippedStories;
+		for (auto id : ids) {
+			if (mSkippedStories->find(id) != mSkippedStories->end()) {
+				stillSkippedStories.insert(id);
+			} else if (topStories.size() < kMaxTopStories) {
+				topStories.push_back(id);
+			}
+		}
+		if (topStories.empty() || topStories == mStories.GetIds()) {
+			return;
+		}
+		mSkippedStories->swap(stillSkippedStories);
+
+		// Queued fetches are for the old positions
+		for (const auto& fetch : mPageFetches) {
+			fetch.second.Cancel();
+		}
+		mPageFetches.clear();
+
+		auto selectedStory = mStories.GetId(mCurrentSelectedStoryIndex);
+		auto diff = StoryListDiff::Compute(mStories.GetIds(), topStories);
+		{
+			// The display thread reads the buffer throughout, so this one
+			// waits for it to finish drawing
+			std::lock_guard<std::mutex> lock(mDisplayMutex);
+			mStories.Rearrange(diff, topStories);
+		}
+
+		// Stay on the same story, or in the same place if it's gone
+		const auto& storyIds = mStories.GetIds();
+		auto selected = std::find(storyIds.begin(), storyIds.end(), selectedStory);
+		auto index = selected != storyIds.end()
+			? static_cast<std::size_t>(selected - storyIds.begin())
+			: std::min(mCurrentSelectedStoryIndex, storyIds.size() - 1);
+		auto page = static_cast<long>(index / kDisplayPageSize);
 		PageIndices indices;
+		TryGetIndicesForDisplayPage(page, indices);
+
+		// Only stories that weren't loaded before go out to the network
+		mCurrentDisplayPage = page;
+		FetchPage(page, FetchPriority::Visible);
+		FetchPrefetchWindow(page);
+		DisplayPage(indices, page);
+		QueueSelection(index);
+	}
 
-		if (skipCurr) {
-			TryGetIndicesForDisplayPage(mCurrentDisplayPage, indices);
-			for (auto index = indices.first; index < indices.second; ++index) {
-				mSkippedStories->insert(mTopStories[index]);
-			}
+	PrefetchStats StateManager::GetPrefetchStats() const {
+		return mPrefetchPolicy.GetStats();
+	}
+
+	std::size_t StateManager::GetStoryStringBytes() const {
+		return mStories.GetArena()->GetSize();
+	}
+
+	SubscriptionStats StateManager::GetSubscriptionStats() const {
+		return mSubscription != nullptr ? mSubscription->GetStats() : mSubscriptionStats;
+	}
+
+	std::unique_ptr<StateManager> StateManager::mInstance = nullptr;
+	StateManager& StateManager::GetInstance() {
+		if (mInstance == nullptr) {
+			mInstance = std::make_unique<StateManager>(Key{});
 		}
+		return *mInstance;
+	}
+
+	void StateManager::LoadFromStorage() {
+		mSkippedStories = mStorage->GetSkippedStoryIds();
+	}
 
+	void StateManager::GotoPage(const long page, const bool isSkimming) {
+		PageIndices indices;
 		if (TryGetIndicesForDisplayPage(page, indices)) {
-			FetchDisplayPage(indices);
-			DisplayPage(indices, page);
+			mPrefetchPolicy.OnPageTurn(mCurrentDisplayPage, page, isSkimming, IsPageLoaded(indices));
+			// Stories queued for pages left behind make way for this one
 			mCurrentDisplayPage = page;
-			SelectStory(indices.first, false);
+			CancelAbandonedFetches();
+			mFetcher->Reprioritise(std::bind(&StateManager::GetFetchPriority, this, std::placeholders::_1));
+			FetchPage(page, FetchPriority::Visible);
+			FetchPrefetchWindow(page);
+			DisplayPage(indices, page);
+			SelectStory(indices.first);
 		}
 	}
 
-	void StateManager::SelectStory(const std::size_t index, const bool skipCurr) {
-		if (skipCurr) {
-			mSkippedStories->insert(mTopStories[index]);
-		}
-
-		if (index < 0 || index >= mTopStories.size()) {
+	void StateManager::SelectStory(const std::size_t index) {
+		if (index >= mStories.GetSize()) {
 			return;
 		}
 
@@ -180,97 +293,179 @@ namespace hackernewscmd {
 		if (index < indices.first || index >= indices.second) {
 			// Load the required page
 			GotoPage(index / kDisplayPageSize, false);
-		} else if (mCurrentSelectedStoryIndex >= indices.first && mCurrentSelectedStoryIndex < indices.second) {
-			// Don't move the selection if there'll be no indication on the console
-			for (auto it = mPagedDisplayBuffer.cbegin() + indices.first; it != mPagedDisplayBuffer.cbegin() + indices.second; ++it) {
-				if (it->second.loadStatus != StoryLoadStatus::Completed
-					&& it->second.loadStatus != StoryLoadStatus::Failed) {
-					return;
-				}
-			}
 		}
 
-		// Wait if a prior instruction is pending a read by the display thread
-		if (mDisplayThreadData.redo) {
-			mDisplayReverseLock.lock();
-			mDisplayReverseCV.wait(mDisplayReverseLock);
-			mDisplayReverseLock.unlock();
-		}
+		QueueSelection(index);
+	}
 
-		SetupDisplayThreadDataForSelectedStory(index);
-		mDisplayCV.notify_all();
+	void StateManager::QueueSelection(const std::size_t index) {
+		DisplayCommand command = {};
+		command.action = DisplayCommand::SelectStory;
+		command.story = &mStories.GetStory(index);
+		PushCommand(command);
 		mCurrentSelectedStoryIndex = index;
 	}
 
+	void StateManager::SkipStory(const std::size_t index) {
+		if (index < mStories.GetSize() && !mStories.IsSkipped(index)) {
+			mStories.SetSkipped(index);
+			mSkippedStories->insert(mStories.GetId(index));
+		}
+	}
+
 	const std::wstring StateManager::kHackerNewsItemUrl = L"https://news.ycombinator.com/item?id=";
 	std::wstring StateManager::GetStoryPageUrl(const Story& story) {
 		return kHackerNewsItemUrl + std::to_wstring(story.id);
 	}
 
-	void StateManager::FetchDisplayPage(const PageIndices& indices) {
+	void StateManager::FetchPage(const long page, const FetchPriority priority) {
+		PageIndices indices;
+		if (page < 0 || !TryGetIndicesForDisplayPage(page, indices)) {
+			return;
+		}
+		auto handle = mFetcher->FetchStories(CreateFetchThreadData(indices, priority));
+		if (!handle.IsDone()) {
+			mPageFetches.push_back(std::make_pair(page, handle));
+		}
+	}
+
+	void StateManager::FetchPrefetchWindow(const long page) {
+		// Nearest pages queued first, so they load first within their class
+		auto firstPage = mPrefetchPolicy.GetFirstPage(page), lastPage = mPrefetchPolicy.GetLastPage(page);
+		for (long distance = 1; page + distance <= lastPage || page - distance >= firstPage; ++distance) {
+			if (page + distance <= lastPage) {
+				FetchPage(page + distance, GetPagePriority(page + distance));
+			}
+			if (page - distance >= firstPage) {
+				FetchPage(page - distance, GetPagePriority(page - distance));
+			}
+		}
+	}
+
+	bool StateManager::IsPageLoaded(const PageIndices& indices) const {
+		return mStories.AreAllCompleted(indices.first, indices.second);
+	}
+
+	void StateManager::CancelAbandonedFetches() {
+		auto end = std::remove_if(mPageFetches.begin(), mPageFetches.end(), [this](const std::pair<long, FetchHandle>& fetch) {
+			if (fetch.second.IsDone()) {
+				return true;
+			}
+			if (fetch.first < mPrefetchPolicy.GetFirstPage(mCurrentDisplayPage)
+				|| fetch.first > mPrefetchPolicy.GetLastPage(mCurrentDisplayPage)) {
+				// Their slots go back to not started, and are fetched again
+				// if the page is revisited
+				fetch.second.Cancel();
+				return true;
+			}
+			return false;
+		});
+		mPageFetches.erase(end, mPageFetches.end());
+	}
+
+	FetchThreadData* StateManager::CreateFetchThreadData(const PageIndices& indices, const FetchPriority priority) {
 		std::vector<std::pair<StoryId, size_t>> toBeLoadedTopStories;
 
 		for (auto startIndex = indices.first; startIndex < indices.second; ++startIndex) {
-			auto& loadStatus = mPagedDisplayBuffer[startIndex].second.loadStatus;
+			auto& loadStatus = mStories.GetLoadStatus(startIndex);
 			auto expectedNotStarted = StoryLoadStatus::NotStarted, expectedFailed = StoryLoadStatus::Failed;
 			if (loadStatus != StoryLoadStatus::Completed
 				&& loadStatus != StoryLoadStatus::Started
 				&& (loadStatus.compare_exchange_strong(expectedNotStarted, StoryLoadStatus::Started)
 					|| loadStatus.compare_exchange_strong(expectedFailed, StoryLoadStatus::Started))) {
-				toBeLoadedTopStories.push_back(std::make_pair(mTopStories[startIndex], startIndex));
+				toBeLoadedTopStories.push_back(std::make_pair(mStories.GetId(startIndex), startIndex));
 			}
 		}
 
-		auto ftd = new FetchThreadData(
+		return new FetchThreadData(
 			std::move(toBeLoadedTopStories),
-			std::move(std::bind(&StateManager::OnFetchStoryComplete, this, std::placeholders::_1, std::placeholders::_2)),
-			std::move(std::bind(&StateManager::OnFetchStoryFailed, this, std::placeholders::_1)));
-		std::async(&NewsFetcher::FetchStories, mFetcher, ftd);
+			std::move(std::bind(&StateManager::OnFetchStoryComplete, this, std::placeholders::_1, std::placeholders::_2, mStories.GetGeneration())),
+			std::move(std::bind(&StateManager::OnFetchStoryFailed, this, std::placeholders::_1, mStories.GetGeneration())),
+			std::move(std::bind(&StateManager::OnFetchStoryCancelled, this, std::placeholders::_1, mStories.GetGeneration())),
+			mStories.GetArena(),
+			priority);
 	}
 
-	void StateManager::DisplayPage(const PageIndices& indices, const long pageIndex) {
-		SetupDisplayThreadDataForPageDisplay(indices, pageIndex + 1);
-		mDisplayCV.notify_all();
+	FetchPriority StateManager::GetFetchPriority(const std::size_t index) const {
+		return GetPagePriority(static_cast<long>(index / kDisplayPageSize));
+	}
+
+	FetchPriority StateManager::GetPagePriority(const long page) const {
+		if (page == mCurrentDisplayPage) {
+			return FetchPriority::Visible;
+		}
+		if (page == mCurrentDisplayPage + 1 || page == mCurrentDisplayPage - 1) {
+			return FetchPriority::Adjacent;
+		}
+		// The rest of the prefetch window; anything outside it is on its way
+		// to being cancelled
+		return FetchPriority::Background;
 	}
 
-	void StateManager::SetupDisplayThreadDataForPageDisplay(const PageIndices& indices, const long currentPage) throw() {
-		mDisplayLock.lock();
-		mDisplayThreadData.redo = true;
-		mDisplayThreadData.action = DisplayThreadData::DisplayPage;
-		mDisplayPageData.begin = mPagedDisplayBuffer.cbegin() + indices.first;
-		mDisplayPageData.end = mPagedDisplayBuffer.cbegin() + indices.second;
-		mDisplayPageData.currentPage = currentPage;
-		mDisplayThreadData.SetPointer(&mDisplayPageData);
-		mDisplayLock.unlock();
+	void StateManager::DisplayPage(const PageIndices& indices, const long pageIndex) {
+		DisplayCommand command = {};
+		command.action = DisplayCommand::DisplayPage;
+		command.page.stories = &mStories;
+		command.page.begin = indices.first;
+		command.page.end = indices.second;
+		command.page.currentPage = pageIndex + 1;
+		command.page.totalPages = (mStories.GetSize() - 1) / kDisplayPageSize;
+		PushCommand(command);
 	}
 
 	bool StateManager::TryGetIndicesForDisplayPage(long page, PageIndices& result) const {
 		auto begin = page * kDisplayPageSize;
-		if (begin >= mPagedDisplayBuffer.size()) {
+		if (begin >= mStories.GetSize()) {
 			return false;
 		}
 
 		result.first = begin;
-		result.second = std::min(begin + kDisplayPageSize, static_cast<unsigned long>(mPagedDisplayBuffer.size()));
+		result.second = std::min(begin + kDisplayPageSize, static_cast<unsigned long>(mStories.GetSize()));
 		return true;
 	}
 
-	void StateManager::SetupDisplayThreadDataForSelectedStory(const size_t index) {
-		mDisplayLock.lock();
-		mDisplayThreadData.redo = true;
-		mDisplayThreadData.action = DisplayThreadData::SelectStory;
-		mDisplayThreadData.SetPointer(&mPagedDisplayBuffer[index].first);
-		mDisplayLock.unlock();
+	void StateManager::PushCommand(const DisplayCommand& command) {
+		while (!mDisplayChannel.commands.TryPush(command)) {
+			// Only when the display thread is hopelessly behind
+			WakeDisplay();
+			std::this_thread::yield();
+		}
+		WakeDisplay();
 	}
 
-	void StateManager::OnFetchStoryComplete(Story story, size_t index) {
-		mPagedDisplayBuffer[index].first = std::move(story);
-		mPagedDisplayBuffer[index].second.loadStatus = StoryLoadStatus::Completed;
-		mDisplayCV.notify_all();
+	void StateManager::OnFetchStoryComplete(Story story, size_t index, unsigned generation) {
+		StoryCompletion completion = { story, index, generation, StoryLoadStatus::Completed };
+		PushCompletion(std::move(completion));
 	}
 
-	void StateManager::OnFetchStoryFailed(size_t index) {
-		mPagedDisplayBuffer[index].second.loadStatus = StoryLoadStatus::Failed;
-		mDisplayCV.notify_all();
+	void StateManager::OnFetchStoryFailed(size_t index, unsigned generation) {
+		StoryCompletion completion = { Story(), index, generation, StoryLoadStatus::Failed };
+		PushCompletion(std::move(completion));
+	}
+
+	void StateManager::OnFetchStoryCancelled(size_t index, unsigned generation) {
+		// Cancelling happens on the input thread, which is also the only one
+		// to rearrange the buffer, and the slot must be free to fetch again
+		// straight away
+		if (generation == mStories.GetGeneration()) {
+			mStories.GetLoadStatus(index) = StoryLoadStatus::NotStarted;
+		}
+	}
+
+	void StateManager::PushCompletion(StoryCompletion&& completion) {
+		if (mDisplayChannel.completions.Push(std::move(completion))) {
+			WakeDisplay(); // Whoever found the queue empty wakes the display thread
+		}
+	}
+
+	void StateManager::WakeDisplay() {
+		// Pairs with the fence in DisplayManager::WaitForWork: either the flag
+		// is seen here or what was queued is seen there. The mutex is only
+		// free once the display thread is actually waiting.
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (mDisplayChannel.isConsumerWaiting) {
+			std::lock_guard<std::mutex> lock(mDisplayMutex);
+			mDisplayCV.notify_all();
+		}
 	}
 } // namespace hackernewscmd
\ No newline at end of file
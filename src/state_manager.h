@@ -24,11 +24,16 @@
 #include <memory>
 #include <mutex>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 #include "display_manager.h"
 #include "fetcher.h"
+#include "prefetch_policy.h"
 #include "storage.h"
 #include "story.h"
+#include "story_buffer.h"
+#include "story_list_diff.h"
+#include "top_stories_subscription.h"
 
 
 namespace hackernewscmd {
@@ -43,56 +48,81 @@ namespace hackernewscmd {
 		StateManager(const Key&) : StateManager(){};
 		void Init(Storage&, NewsFetcher&, DisplayManager&);
 		void Start();
-		void GotoNextPage(bool);
-		void GotoPrevPage(bool);
-		void SelectNextStory(bool);
-		void SelectPrevStory(bool);
+		// By a number of stories or pages, marking those at the given
+		// positions, relative to the current one, skipped on the way
+		void MoveSelection(long, long, long);
+		void TurnPages(long, long, long);
 		void OpenSelectedStory(bool);
+		// Downloads the list again, keeping the stories already loaded. Returns
+		// at once, the list being taken in once it's arrived.
+		void RefreshStories();
+		// Keeps the list up to date from the API's stream of changes
+		void SubscribeToTopStories();
+		// Takes in the latest list streamed or refreshed, on the input thread
+		void ApplyStreamedTopStories();
 		void Quit();
+		PrefetchStats GetPrefetchStats() const;
+		SubscriptionStats GetSubscriptionStats() const;
+		// Held by the titles and URLs of the list as it stands
+		std::size_t GetStoryStringBytes() const;
 		static StateManager& GetInstance();
 
 	private:
 		StateManager();
 		bool mIsInited;
 
-		std::vector<StoryAndStatus> mPagedDisplayBuffer;
+		StoryBuffer mStories;
 		long mCurrentDisplayPage;
 		std::size_t mCurrentSelectedStoryIndex;
-		std::vector<StoryId> mTopStories;
 		std::unordered_set<StoryId> *mSkippedStories;
+		std::vector<std::pair<long, FetchHandle>> mPageFetches; // By page, so that leaving a page can cancel them
+		PrefetchPolicy mPrefetchPolicy;
+		DisplayChannel mDisplayChannel; // Read by the display thread
+		std::unique_ptr<TopStoriesSubscription> mSubscription;
+		SubscriptionStats mSubscriptionStats; // As of the subscription ending
+		std::vector<StoryId> mStreamedTopStories; // Streamed or refreshed, empty once taken in
+		std::mutex mStreamedTopStoriesMutex;
 
 		std::condition_variable mDisplayCV;
-		std::mutex mDisplayMutex;
-		std::unique_lock<std::mutex> mDisplayLock;
-		std::condition_variable mDisplayReverseCV;
-		std::mutex mDisplayReverseMutex;
-		std::unique_lock<std::mutex> mDisplayReverseLock;
-		DisplayThreadData mDisplayThreadData;
-		DisplayThreadData::DisplayPageData mDisplayPageData;
+		std::mutex mDisplayMutex; // Held by the display thread unless it's waiting
 
 		Storage* mStorage;
 		NewsFetcher* mFetcher;
 		DisplayManager* mDisplayManager;
 
 		void LoadFromStorage();
-		void FetchTopStories();
-		void DiffTopStories();
 		void GotoPage(const long, const bool);
-		void SelectStory(const std::size_t, const bool);
+		void SelectStory(const std::size_t);
+		void QueueSelection(const std::size_t);
+		// Marks the story at the index to be left out from the next run on
+		void SkipStory(const std::size_t);
+		void ReplaceTopStories(const std::vector<StoryId>&);
+		void OnTopStoriesStreamed(std::vector<StoryId>);
 
 		static std::wstring GetStoryPageUrl(const Story&);
 
 		using PageIndices = std::pair < std::size_t, std::size_t >;
-		void FetchDisplayPage(const PageIndices&);
+		void FetchPage(const long, const FetchPriority);
+		void FetchPrefetchWindow(const long);
+		bool IsPageLoaded(const PageIndices&) const;
+		void CancelAbandonedFetches();
+		FetchThreadData* CreateFetchThreadData(const PageIndices&, const FetchPriority);
+		FetchPriority GetFetchPriority(const std::size_t) const;
+		FetchPriority GetPagePriority(const long) const;
 		void DisplayPage(const PageIndices&, long);
-		void SetupDisplayThreadDataForPageDisplay(const PageIndices&, long);
 		bool TryGetIndicesForDisplayPage(long, PageIndices&) const;
-		void SetupDisplayThreadDataForSelectedStory(const std::size_t);
-		void OnFetchStoryComplete(Story, size_t);
-		void OnFetchStoryFailed(size_t);
+		// Never waits on the display thread, short of its commands filling up
+		void PushCommand(const DisplayCommand&);
+		// Callbacks are tagged with the buffer generation they were made for
+		void OnFetchStoryComplete(Story, size_t, unsigned);
+		void OnFetchStoryFailed(size_t, unsigned);
+		void OnFetchStoryCancelled(size_t, unsigned);
+		void PushCompletion(StoryCompletion&&);
+		void WakeDisplay();
 
 		static std::unique_ptr<StateManager> mInstance;
 		static const std::size_t kDisplayPageSize = 10;
+		static const std::size_t kMaxTopStories = 500; // The API never lists more
 		static const std::wstring kHackerNewsItemUrl;
 	}; // class SateManager
 } // hnamespace hackernewscmd
\ No newline at end of file
@@ -27,22 +27,31 @@
 
 namespace hackernewscmd {
 	const std::string Storage::kFilename = "hackernewscmd.dat";
+	const std::string Storage::kCacheFilename = "hackernewscmd.cache";
 
 	Storage::Storage(std::string&& filepath, const Key&) {
 		char buffer[MAX_PATH];
 		::PathCombineA(buffer, filepath.c_str(), kFilename.c_str());
 		mFilepath = std::string(buffer);
+		::PathCombineA(buffer, filepath.c_str(), kCacheFilename.c_str());
+		mCacheFilepath = std::string(buffer);
 		ReadSkippedStoryIds();
+		mItemCache.Read(mCacheFilepath);
 	}
 
 	Storage::~Storage() {
 		WriteSkippedStoryIds();
+		mItemCache.Write(mCacheFilepath);
 	}
 
 	std::unordered_set<StoryId>* Storage::GetSkippedStoryIds() {
 		return &mSkippedStoryIds;
 	}
 
+	ItemCache* Storage::GetItemCache() {
+		return &mItemCache;
+	}
+
 	std::unique_ptr<Storage> Storage::mInstance = nullptr;
 	Storage& Storage::GetInstance() {
 		if (mInstance == nullptr) {
@@ -23,6 +23,7 @@
 #include <memory>
 #include <string>
 #include <unordered_set>
+#include "item_cache.h"
 #include "story.h"
 
 
@@ -36,16 +37,20 @@ namespace hackernewscmd {
 		~Storage();
 
 		std::unordered_set<StoryId>* GetSkippedStoryIds();
+		ItemCache* GetItemCache();
 
 		static Storage& GetInstance();
 	private:
 		std::string mFilepath;
+		std::string mCacheFilepath;
 		std::unordered_set<StoryId> mSkippedStoryIds;
+		ItemCache mItemCache;
 
 		void ReadSkippedStoryIds();
 		void WriteSkippedStoryIds();
 
 		static std::unique_ptr<Storage> mInstance;
 		static const std::string kFilename;
+		static const std::string kCacheFilename;
 	};
 } // namespace hackernewscmd
\ No newline at end of file
@@ -20,13 +20,16 @@
 #pragma once
 
 #include <atomic>
+#include <ctime>
 #include <functional>
 #include <string>
 #include <utility>
+#include "string_arena.h"
 
 
 namespace hackernewscmd {
-	enum class StoryLoadStatus {
+	// A byte, so that the load states of a whole list sit in a few cache lines
+	enum class StoryLoadStatus : unsigned char {
 		NotStarted,
 		Started,
 		Failed,
@@ -35,28 +38,29 @@ namespace hackernewscmd {
 
 	using StoryId = unsigned long long;
 
+	/**
+	 * Strings are kept in UTF-8, as received, in the arena of the story
+	 * list they were fetched for, and are only widened when they're
+	 * displayed. The author, and the host of the URL, are interned in the
+	 * fetcher when the story is parsed.
+	 * A story is small and owns nothing, so it's passed around by value.
+	 */
 	struct Story {
 		StoryId id = 0;
-		std::wstring title;
-		std::wstring url;
-		unsigned score;
-		unsigned descendants;
-		time_t time;
-		std::wstring by;
-	}; // struct Story
-
-	struct StoryStatus {
-		std::atomic<StoryLoadStatus> loadStatus;
-		bool isSkipped;
-
-		StoryStatus() :
-			loadStatus(StoryLoadStatus::NotStarted),
-			isSkipped(false) {};
+		StringRef title;
+		StringRef url;
+		time_t time = 0;
+		unsigned score = 0;
+		unsigned descendants = 0;
+		StringTable::Id by = 0;
+		StringTable::Id host = 0; // 0 when the URL has none
 
-		StoryStatus(const StoryStatus& other) :
-			loadStatus(other.loadStatus.load()),
-			isSkipped(other.isSkipped) {};
-	};
-
-	using StoryAndStatus = std::pair < Story, StoryStatus >;
+		// The same story, with its strings stored anew in the arena
+		Story CopyInto(StringArena& arena) const {
+			Story story = *this;
+			story.title = arena.Store(title.data, title.length);
+			story.url = arena.Store(url.data, url.length);
+			return story;
+		}
+	}; // struct Story
 } // namespace hackernewscmd
@@ -0,0 +1,114 @@
+/**
+ * @file story_buffer.cpp
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "story_buffer.h"
+#include <stdexcept>
+#include <utility>
+
+
+namespace hackernewscmd {
+	StoryBuffer::StoryBuffer(std::size_t capacity) :
+		mCapacity(capacity),
+		mLoadStatuses(new std::atomic<StoryLoadStatus>[capacity]),
+		mStories(capacity),
+		mGeneration(0),
+		mArena(std::make_shared<StringArena>()) {
+		mIds.reserve(capacity);
+		mSkipped.reserve(capacity);
+		for (std::size_t index = 0; index < capacity; ++index) {
+			mLoadStatuses[index] = StoryLoadStatus::NotStarted;
+		}
+	}
+
+	bool StoryBuffer::IsSettled(std::size_t index) const {
+		auto loadStatus = mLoadStatuses[index].load();
+		return loadStatus == StoryLoadStatus::Completed || loadStatus == StoryLoadStatus::Failed;
+	}
+
+	bool StoryBuffer::AreAllSettled(std::size_t first, std::size_t last) const {
+		for (auto index = first; index < last; ++index) {
+			if (!IsSettled(index)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool StoryBuffer::AreAllCompleted(std::size_t first, std::size_t last) const {
+		for (auto index = first; index < last; ++index) {
+			if (mLoadStatuses[index] != StoryLoadStatus::Completed) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool StoryBuffer::Publish(const StoryCompletion& completion) {
+		if (completion.generation != mGeneration) {
+			return false;
+		}
+		if (completion.loadStatus == StoryLoadStatus::Completed) {
+			mStories[completion.index] = completion.story;
+		}
+		mLoadStatuses[completion.index].store(completion.loadStatus, std::memory_order_release);
+		return true;
+	}
+
+	void StoryBuffer::Append(StoryId id) {
+		if (IsFull()) {
+			throw std::runtime_error("Story buffer is full");
+		}
+		auto index = mIds.size();
+		mStories[index] = Story();
+		mStories[index].id = id;
+		mLoadStatuses[index] = StoryLoadStatus::NotStarted;
+		mSkipped.push_back(false);
+		mIds.push_back(id);
+	}
+
+	void StoryBuffer::Rearrange(const StoryListDiff& diff, const std::vector<StoryId>& ids) {
+		if (ids.size() > mCapacity) {
+			throw std::runtime_error("Story buffer is full");
+		}
+
+		auto arena = std::make_shared<StringArena>();
+		std::vector<Story> stories(ids.size());
+		std::vector<StoryLoadStatus> loadStatuses(ids.size(), StoryLoadStatus::NotStarted);
+		std::vector<bool> skipped(ids.size());
+		for (const auto& move : diff.moves) {
+			stories[move.second] = mStories[move.first].CopyInto(*arena);
+			auto loadStatus = mLoadStatuses[move.first].load();
+			loadStatuses[move.second] = loadStatus == StoryLoadStatus::Started ? StoryLoadStatus::NotStarted : loadStatus;
+			skipped[move.second] = mSkipped[move.first];
+		}
+		for (auto index : diff.insertions) {
+			stories[index].id = ids[index];
+		}
+
+		// Within capacity, so nothing moves
+		for (std::size_t index = 0; index < ids.size(); ++index) {
+			mStories[index] = stories[index];
+			mLoadStatuses[index] = loadStatuses[index];
+		}
+		mSkipped.assign(skipped.begin(), skipped.end());
+		mIds.assign(ids.begin(), ids.end());
+		mArena = std::move(arena);
+		++mGeneration;
+	}
+} // namespace hackernewscmd
\ No newline at end of file
@@ -0,0 +1,108 @@
+/**
+ * @file story_buffer.h
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "story.h"
+#include "story_list_diff.h"
+
+
+namespace hackernewscmd {
+	/**
+	 * A story that has finished loading, one way or the other, on its way
+	 * from a fetch thread to its slot
+	 */
+	struct StoryCompletion {
+		Story story;
+		std::size_t index;
+		unsigned generation; // Of the buffer, when the story was asked for
+		StoryLoadStatus loadStatus; // Completed or failed
+	};
+
+	/**
+	 * The top stories, laid out as parallel arrays so that scans over ids,
+	 * load states or skips touch only that array. Stories themselves are
+	 * kept apart, and read only for display.
+	 *
+	 * Storage for the full capacity is allocated up front and never moves,
+	 * so slots can be written by fetch callbacks while the list is still
+	 * growing, and the display can hold on to them.
+	 *
+	 * Each generation has an arena of its own for the stories' strings, so
+	 * that what a list no longer shows is freed with it.
+	 */
+	class StoryBuffer {
+	public:
+		explicit StoryBuffer(std::size_t);
+		StoryBuffer(const StoryBuffer&) = delete;
+		StoryBuffer& operator=(const StoryBuffer&) = delete;
+
+		std::size_t GetSize() const { return mIds.size(); }
+		bool IsFull() const { return mIds.size() == mCapacity; }
+		const std::vector<StoryId>& GetIds() const { return mIds; }
+		StoryId GetId(std::size_t index) const { return mIds[index]; }
+
+		std::atomic<StoryLoadStatus>& GetLoadStatus(std::size_t index) { return mLoadStatuses[index]; }
+		StoryLoadStatus GetLoadStatus(std::size_t index) const { return mLoadStatuses[index].load(); }
+		// Completed or failed, either way there's something to show
+		bool IsSettled(std::size_t) const;
+		bool AreAllSettled(std::size_t, std::size_t) const;
+		bool AreAllCompleted(std::size_t, std::size_t) const;
+
+		bool IsSkipped(std::size_t index) const { return mSkipped[index]; }
+		void SetSkipped(std::size_t index) { mSkipped[index] = true; }
+
+		Story& GetStory(std::size_t index) { return mStories[index]; }
+		const Story& GetStory(std::size_t index) const { return mStories[index]; }
+
+		// Bumped by every rearrangement, so that fetches made for the old
+		// layout can be told apart
+		unsigned GetGeneration() const { return mGeneration; }
+		// Where the stories fetched for this generation keep their strings.
+		// Fetches share it, so it outlives the generation until they're done.
+		const std::shared_ptr<StringArena>& GetArena() const { return mArena; }
+		// Fills in a slot, unless the buffer has been rearranged since the
+		// story was asked for. The story is written before the load state
+		// is released, so whoever sees the state completed sees the story.
+		bool Publish(const StoryCompletion&);
+
+		// Adds a story that hasn't been loaded yet. Throws std::runtime_error
+		// when full.
+		void Append(StoryId);
+		// Lays the stories out in the order of a new list, keeping what was
+		// loaded for those still on it. Stories that were loading go back to
+		// not started, since their fetches report to the old positions. The
+		// strings of the stories kept are copied to a new arena, and the old
+		// one let go.
+		void Rearrange(const StoryListDiff&, const std::vector<StoryId>&);
+
+	private:
+		const std::size_t mCapacity;
+		std::vector<StoryId> mIds; // Reserved to capacity
+		std::unique_ptr<std::atomic<StoryLoadStatus>[]> mLoadStatuses;
+		std::vector<bool> mSkipped;
+		std::vector<Story> mStories; // Sized to capacity
+		unsigned mGeneration;
+		std::shared_ptr<StringArena> mArena;
+	}; // class StoryBuffer
+} // namespace hackernewscmd
\ No newline at end of file
@@ -0,0 +1,108 @@
+/**
+ * @file story_id_parser.cpp
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "story_id_parser.h"
+#include <stdexcept>
+
+
+namespace hackernewscmd {
+	StoryIdParser::StoryIdParser(const std::function<void(StoryId)>& handler) :
+		mHandler(handler),
+		mState(State::BeforeArray),
+		mValue(0),
+		mLiteralLength(0) {}
+
+	void StoryIdParser::Parse(const char* data, std::size_t length) {
+		static const char kNull[] = "null";
+
+		for (std::size_t i = 0; i < length; ++i) {
+			auto c = data[i];
+			switch (mState) {
+			case State::BeforeArray:
+				if (c == '[') {
+					mState = State::BeforeFirstValue;
+				} else if (!IsWhitespace(c)) {
+					throw std::runtime_error("Error while parsing response JSON");
+				}
+				break;
+			case State::BeforeFirstValue:
+				if (c == ']') {
+					mState = State::Done;
+				} else if (!IsWhitespace(c)) {
+					mState = State::BeforeValue;
+					--i; // Let BeforeValue look at this character
+				}
+				break;
+			case State::BeforeValue:
+				// A comma must be followed by a value, not the end of the array
+				if (c >= '0' && c <= '9') {
+					mValue = c - '0';
+					mState = State::InNumber;
+				} else if (c == kNull[0]) {
+					mLiteralLength = 1;
+					mState = State::InNull;
+				} else if (!IsWhitespace(c)) {
+					throw std::runtime_error("Error while parsing response JSON");
+				}
+				break;
+			case State::InNumber:
+				if (c >= '0' && c <= '9') {
+					mValue = mValue * 10 + (c - '0');
+					break;
+				}
+				mHandler(mValue);
+				mState = State::AfterValue;
+				--i; // Let AfterValue look at this character
+				break;
+			case State::InNull:
+				if (c != kNull[mLiteralLength]) {
+					throw std::runtime_error("Error while parsing response JSON");
+				}
+				if (++mLiteralLength == sizeof(kNull) - 1) {
+					mState = State::AfterValue;
+				}
+				break;
+			case State::AfterValue:
+				if (c == ',') {
+					mState = State::BeforeValue;
+				} else if (c == ']') {
+					mState = State::Done;
+				} else if (!IsWhitespace(c)) {
+					throw std::runtime_error("Error while parsing response JSON");
+				}
+				break;
+			case State::Done:
+				if (!IsWhitespace(c)) {
+					throw std::runtime_error("Error while parsing response JSON");
+				}
+				break;
+			}
+		}
+	}
+
+	void StoryIdParser::Finish() const {
+		if (mState != State::Done) {
+			throw std::runtime_error("Error while parsing response JSON");
+		}
+	}
+
+	bool StoryIdParser::IsWhitespace(char c) {
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+} // namespace hackernewscmd
\ No newline at end of file
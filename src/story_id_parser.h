@@ -0,0 +1,62 @@
+/**
+ * @file story_id_parser.h
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include "story.h"
+
+
+namespace hackernewscmd {
+	/**
+	 * Incremental parser for a JSON array of story ids, such as the one
+	 * served at /topstories.json.
+	 * Bytes are pushed in as they arrive and every id is handed to the
+	 * handler as soon as it has been read in full; null entries are dropped.
+	 */
+	class StoryIdParser {
+	public:
+		StoryIdParser(const std::function<void(StoryId)>&);
+		StoryIdParser& operator=(const StoryIdParser&) = delete;
+
+		// Throws std::runtime_error on malformed input
+		void Parse(const char*, std::size_t);
+		// Throws std::runtime_error if the array hasn't been closed
+		void Finish() const;
+
+	private:
+		enum class State {
+			BeforeArray,
+			BeforeFirstValue, // Where the array may close empty
+			BeforeValue,
+			InNumber,
+			InNull,
+			AfterValue,
+			Done
+		};
+
+		const std::function<void(StoryId)> mHandler;
+		State mState;
+		StoryId mValue;
+		std::size_t mLiteralLength;
+
+		static bool IsWhitespace(char);
+	}; // class StoryIdParser
+} // namespace hackernewscmd
\ No newline at end of file
@@ -0,0 +1,48 @@
+/**
+ * @file story_list_diff.cpp
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "story_list_diff.h"
+#include <unordered_map>
+
+
+namespace hackernewscmd {
+	StoryListDiff StoryListDiff::Compute(const std::vector<StoryId>& oldIds, const std::vector<StoryId>& newIds) {
+		std::unordered_map<StoryId, std::size_t> oldIndices;
+		oldIndices.reserve(oldIds.size());
+		for (std::size_t index = 0; index < oldIds.size(); ++index) {
+			oldIndices[oldIds[index]] = index;
+		}
+
+		StoryListDiff diff;
+		for (std::size_t index = 0; index < newIds.size(); ++index) {
+			auto old = oldIndices.find(newIds[index]);
+			if (old == oldIndices.end()) {
+				diff.insertions.push_back(index);
+				continue;
+			}
+			diff.moves.push_back(std::make_pair(old->second, index));
+			oldIndices.erase(old);
+		}
+		// Whatever wasn't claimed by the new list has dropped off it
+		for (const auto& old : oldIndices) {
+			diff.removals.push_back(old.second);
+		}
+		return diff;
+	}
+} // namespace hackernewscmd
\ No newline at end of file
@@ -0,0 +1,40 @@
+/**
+ * @file story_list_diff.h
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "story.h"
+
+
+namespace hackernewscmd {
+	/**
+	 * How one list of story ids became another. Stories on both lists are
+	 * moves, even when they stay where they were.
+	 */
+	struct StoryListDiff {
+		std::vector<std::pair<std::size_t, std::size_t>> moves; // Old index, new index
+		std::vector<std::size_t> insertions; // New indices
+		std::vector<std::size_t> removals; // Old indices
+
+		static StoryListDiff Compute(const std::vector<StoryId>&, const std::vector<StoryId>&);
+	}; // struct StoryListDiff
+} // namespace hackernewscmd
\ No newline at end of file
@@ -0,0 +1,103 @@
+/**
+ * @file string_arena.cpp
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "string_arena.h"
+#include <algorithm>
+#include <cstring>
+
+#undef max
+
+
+namespace hackernewscmd {
+	StringArena::StringArena() :
+		mNext(nullptr),
+		mAvailable(0),
+		mSize(0) {}
+
+	StringRef StringArena::Store(const char* data, std::size_t length) {
+		if (length == 0) {
+			return StringRef();
+		}
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (length > mAvailable) {
+			// Whatever is left of the current block is abandoned; a string
+			// longer than a block gets one of its own
+			auto blockSize = std::max(length, static_cast<std::size_t>(kBlockSize));
+			mBlocks.emplace_back(new char[blockSize]);
+			mNext = mBlocks.back().get();
+			mAvailable = blockSize;
+		}
+		auto stored = mNext;
+		std::memcpy(stored, data, length);
+		mNext += length;
+		mAvailable -= length;
+		mSize += length;
+		return StringRef(stored, static_cast<std::uint32_t>(length));
+	}
+
+	std::size_t StringArena::GetSize() const {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mSize;
+	}
+
+	std::size_t StringTable::Hash::operator()(const StringRef& str) const {
+		// FNV-1a
+		std::size_t hash = 2166136261u;
+		for (std::uint32_t i = 0; i < str.length; ++i) {
+			hash = (hash ^ static_cast<unsigned char>(str.data[i])) * 16777619u;
+		}
+		return hash;
+	}
+
+	bool StringTable::Equal::operator()(const StringRef& lhs, const StringRef& rhs) const {
+		return lhs.length == rhs.length && std::memcmp(lhs.data, rhs.data, lhs.length) == 0;
+	}
+
+	StringTable::StringTable(StringArena& arena) :
+		mArena(arena) {
+		mStrings.push_back(StringRef());
+	}
+
+	StringTable::Id StringTable::Intern(const char* data, std::size_t length) {
+		if (length == 0) {
+			return 0;
+		}
+		std::lock_guard<std::mutex> lock(mMutex);
+		// Looked up in place, the string is only copied when it's new
+		auto it = mIds.find(StringRef(data, static_cast<std::uint32_t>(length)));
+		if (it != mIds.end()) {
+			return it->second;
+		}
+		auto stored = mArena.Store(data, length);
+		auto id = static_cast<Id>(mStrings.size());
+		mStrings.push_back(stored);
+		mIds.emplace(stored, id);
+		return id;
+	}
+
+	StringRef StringTable::Lookup(Id id) const {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return id < mStrings.size() ? mStrings[id] : StringRef();
+	}
+
+	std::size_t StringTable::GetCount() const {
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mStrings.size() - 1;
+	}
+} // namespace hackernewscmd
\ No newline at end of file
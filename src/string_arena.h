@@ -0,0 +1,102 @@
+/**
+ * @file string_arena.h
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace hackernewscmd {
+	/**
+	 * Refers to characters owned by a StringArena, which aren't zero
+	 * terminated. Copies are as cheap as the pointer.
+	 */
+	struct StringRef {
+		const char* data;
+		std::uint32_t length;
+
+		StringRef() : data(nullptr), length(0) {};
+		StringRef(const char* d, std::uint32_t l) : data(d), length(l) {};
+
+		bool IsEmpty() const { return length == 0; }
+		std::string ToString() const { return std::string(data, length); }
+	};
+
+	/**
+	 * Bump allocator for strings that live as long as the arena.
+	 * Strings are packed into large blocks, so storing one rarely touches
+	 * the heap and nothing is ever moved or freed on its own.
+	 * Safe to store into from any thread.
+	 */
+	class StringArena {
+	public:
+		StringArena();
+		StringArena(const StringArena&) = delete;
+		StringArena& operator=(const StringArena&) = delete;
+
+		StringRef Store(const char*, std::size_t);
+		// Characters stored, not counting what's left unused in the blocks
+		std::size_t GetSize() const;
+
+	private:
+		std::vector<std::unique_ptr<char[]>> mBlocks;
+		char* mNext;
+		std::size_t mAvailable;
+		std::size_t mSize;
+		mutable std::mutex mMutex;
+		static const std::size_t kBlockSize = 64 * 1024;
+	}; // class StringArena
+
+	/**
+	 * Hands out a small id for every distinct string, storing each one only
+	 * once in the arena. Id 0 is the empty string.
+	 * Safe to use from any thread.
+	 */
+	class StringTable {
+	public:
+		using Id = std::uint32_t;
+
+		StringTable(StringArena&);
+		StringTable(const StringTable&) = delete;
+		StringTable& operator=(const StringTable&) = delete;
+
+		Id Intern(const char*, std::size_t);
+		StringRef Lookup(Id) const;
+		std::size_t GetCount() const;
+
+	private:
+		struct Hash {
+			std::size_t operator()(const StringRef&) const;
+		};
+		struct Equal {
+			bool operator()(const StringRef&, const StringRef&) const;
+		};
+
+		StringArena& mArena;
+		std::vector<StringRef> mStrings; // By id
+		std::unordered_map<StringRef, Id, Hash, Equal> mIds;
+		mutable std::mutex mMutex;
+	}; // class StringTable
+} // namespace hackernewscmd
\ No newline at end of file
@@ -0,0 +1,601 @@
+/**
+ * @file terminal.cpp
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "terminal.h"
+#include <algorithm>
+#include <stdexcept>
+
+#undef min
+#undef max
+
+// Older SDKs predate the console taking VT sequences
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#endif
+
+
+namespace hackernewscmd {
+	ConsoleTerminal::ConsoleTerminal() :
+		mOutputHandle(NULL),
+		mOriginalOutputHandle(NULL),
+		mDirty({ 0, 0, -1, -1 }),
+		mContentRows(0),
+		mHasPendingScroll(false),
+		mScrollTop(0),
+		mScrollBottom(0),
+		mCallCount(0) {
+		if ((mOriginalOutputHandle = ::CreateFileW(L"CONOUT$", GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL)) == INVALID_HANDLE_VALUE) {
+			throw std::runtime_error("Couldn't open console output handle");
+		}
+		if ((mOutputHandle = ::CreateConsoleScreenBuffer(GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, CONSOLE_TEXTMODE_BUFFER, NULL)) == INVALID_HANDLE_VALUE) {
+			throw std::runtime_error("Couldn't create new screen buffer");
+		}
+		if (::SetConsoleActiveScreenBuffer(mOutputHandle) == 0) {
+			throw std::runtime_error("Couldn't set active screen buffer");
+		}
+		CONSOLE_SCREEN_BUFFER_INFO csbi;
+		if (::GetConsoleScreenBufferInfo(mOutputHandle, &csbi) == 0) {
+			throw std::runtime_error("Couldn't load screen buffer info");
+		}
+		mBufferSize = csbi.dwSize;
+		mDefaultAttributes = mClearedAttributes = csbi.wAttributes;
+
+		// A new screen buffer starts out blank
+		CHAR_INFO blank;
+		blank.Char.UnicodeChar = L' ';
+		blank.Attributes = mDefaultAttributes;
+		mCells.assign(mBufferSize.X * mBufferSize.Y, blank);
+
+		CONSOLE_CURSOR_INFO cci{ 1, false };
+		if (!::SetConsoleCursorInfo(mOutputHandle, &cci)) {
+			throw std::runtime_error("Couldn't hide cursor " + std::to_string(::GetLastError()));
+		}
+	}
+
+	ConsoleTerminal::~ConsoleTerminal() {
+		::SetConsoleActiveScreenBuffer(mOriginalOutputHandle);
+		::CloseHandle(mOutputHandle);
+		::CloseHandle(mOriginalOutputHandle);
+	}
+
+	COORD ConsoleTerminal::GetSize() const {
+		return mBufferSize;
+	}
+
+	void ConsoleTerminal::Resize(short rows) {
+		if (rows <= mBufferSize.Y) {
+			return;
+		}
+		++mCallCount;
+		if (!::SetConsoleScreenBufferSize(mOutputHandle, { mBufferSize.X, rows })) {
+			throw std::runtime_error("Couldn't create space for line");
+		}
+		CHAR_INFO blank;
+		blank.Char.UnicodeChar = L' ';
+		blank.Attributes = mDefaultAttributes;
+		mCells.resize(mBufferSize.X * rows, blank);
+		mBufferSize.Y = rows;
+	}
+
+	unsigned short ConsoleTerminal::GetDefaultAttributes() const {
+		return mDefaultAttributes;
+	}
+
+	void ConsoleTerminal::Clear(unsigned short attributes) {
+		for (auto& cell : mCells) {
+			cell.Char.UnicodeChar = L' ';
+			cell.Attributes = attributes;
+		}
+		if (attributes == mClearedAttributes) {
+			// Only what's been drawn since the last clear needs blanking
+			if (mContentRows > 0) {
+				MarkDirty({ 0, 0, short(mBufferSize.X - 1), short(mContentRows - 1) });
+			}
+		} else {
+			// Rare enough, but the whole of a tall buffer is better filled
+			// by the console than copied across
+			COORD root{ 0, 0 };
+			auto bufferSize = mBufferSize.X * mBufferSize.Y;
+			unsigned long charsWritten;
+			mCallCount += 2;
+			if (::FillConsoleOutputCharacterW(mOutputHandle, L' ', bufferSize, root, &charsWritten) == 0) {
+				throw std::runtime_error("Couldn't fill screen with blanks");
+			}
+			if (::FillConsoleOutputAttribute(mOutputHandle, attributes, bufferSize, root, &charsWritten) == 0) {
+				throw std::runtime_error("Couldn't set attributes for screen buffer");
+			}
+			mClearedAttributes = attributes;
+			mDirty = { 0, 0, -1, -1 };
+		}
+		mContentRows = 0;
+	}
+
+	void ConsoleTerminal::WriteText(COORD position, const wchar_t* text, std::size_t length) {
+		if (position.Y < 0 || position.Y >= mBufferSize.Y || position.X >= mBufferSize.X || length == 0) {
+			return;
+		}
+		length = std::min(length, std::size_t(mBufferSize.X - position.X));
+		auto row = mCells.begin() + position.Y * mBufferSize.X;
+		// Only the cells that actually change go out
+		short left = mBufferSize.X, right = -1;
+		for (std::size_t i = 0; i < length; ++i) {
+			auto& cell = row[position.X + i];
+			if (cell.Char.UnicodeChar != text[i]) {
+				cell.Char.UnicodeChar = text[i];
+				left = std::min(left, short(position.X + i));
+				right = short(position.X + i);
+			}
+		}
+		if (left <= right) {
+			MarkDirty({ left, position.Y, right, position.Y });
+		}
+	}
+
+	void ConsoleTerminal::SetAttributes(const SMALL_RECT& region, unsigned short attributes) {
+		auto right = std::min(region.Right, short(mBufferSize.X - 1));
+		auto bottom = std::min(region.Bottom, short(mBufferSize.Y - 1));
+		// Written from the copy alone, never read back from the console
+		for (auto row = std::max(region.Top, short(0)); row <= bottom; ++row) {
+			short changedLeft = mBufferSize.X, changedRight = -1;
+			for (auto column = std::max(region.Left, short(0)); column <= right; ++column) {
+				auto& cell = mCells[row * mBufferSize.X + column];
+				if (cell.Attributes != attributes) {
+					cell.Attributes = attributes;
+					changedLeft = std::min(changedLeft, column);
+					changedRight = column;
+				}
+			}
+			if (changedLeft <= changedRight) {
+				MarkDirty({ changedLeft, row, changedRight, row });
+			}
+		}
+	}
+
+	void ConsoleTerminal::ScrollTo(short top, short bottom) {
+		mHasPendingScroll = true;
+		mScrollTop = top;
+		mScrollBottom = bottom;
+	}
+
+	void ConsoleTerminal::Flush() {
+		if (mDirty.Top <= mDirty.Bottom) {
+			// In one call, unless the rectangle's too big for the console
+			auto rowsPerBlit = std::max(short(1), short(kMaxBlitCells / (mDirty.Right - mDirty.Left + 1)));
+			for (auto top = mDirty.Top; top <= mDirty.Bottom; top += rowsPerBlit) {
+				SMALL_RECT region = { mDirty.Left, top, mDirty.Right, std::min(mDirty.Bottom, short(top + rowsPerBlit - 1)) };
+				++mCallCount;
+				if (!::WriteConsoleOutputW(mOutputHandle, mCells.data(), mBufferSize, { region.Left, region.Top }, &region)) {
+					throw std::runtime_error("Couldn't write output characters");
+				}
+			}
+			mContentRows = std::max(mContentRows, short(mDirty.Bottom + 1));
+			mDirty = { 0, 0, -1, -1 };
+		}
+		if (mHasPendingScroll) {
+			mHasPendingScroll = false;
+			ScrollWindow();
+		}
+	}
+
+	unsigned long ConsoleTerminal::GetCallCount() const {
+		return mCallCount;
+	}
+
+	void ConsoleTerminal::ScrollWindow() {
+		// The window may have been scrolled by hand since, so it's asked for
+		// rather than remembered
+		CONSOLE_SCREEN_BUFFER_INFO csbi;
+		++mCallCount;
+		if (::GetConsoleScreenBufferInfo(mOutputHandle, &csbi) == 0) {
+			throw std::runtime_error("Couldn't load screen buffer info");
+		}
+		auto window = csbi.srWindow;
+		short offset = 0;
+		if (mScrollBottom > window.Bottom) {
+			offset = mScrollBottom - window.Bottom;
+		}
+		if (mScrollTop < window.Top + offset) {
+			offset = mScrollTop - window.Top;
+		}
+		if (offset == 0) {
+			return;
+		}
+		SMALL_RECT delta = { 0, offset, 0, offset };
+		++mCallCount;
+		if (!::SetConsoleWindowInfo(mOutputHandle, FALSE, &delta)) {
+			throw std::runtime_error("Couldn't scroll to location of story");
+		}
+	}
+
+	void ConsoleTerminal::MarkDirty(const SMALL_RECT& region) {
+		if (mDirty.Top > mDirty.Bottom) {
+			mDirty = region;
+			return;
+		}
+		mDirty.Left = std::min(mDirty.Left, region.Left);
+		mDirty.Top = std::min(mDirty.Top, region.Top);
+		mDirty.Right = std::max(mDirty.Right, region.Right);
+		mDirty.Bottom = std::max(mDirty.Bottom, region.Bottom);
+	}
+
+	VirtualTerminal::VirtualTerminal() :
+		mOutputHandle(NULL),
+		mOriginalMode(0),
+		mWindowTop(0),
+		mCallCount(0) {
+		if ((mOutputHandle = ::CreateFileW(L"CONOUT$", GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL)) == INVALID_HANDLE_VALUE) {
+			throw std::runtime_error("Couldn't open console output handle");
+		}
+		if (!::GetConsoleMode(mOutputHandle, &mOriginalMode)
+			|| !::SetConsoleMode(mOutputHandle, mOriginalMode | ENABLE_PROCESSED_OUTPUT | ENABLE_VIRTUAL_TERMINAL_PROCESSING)) {
+			throw std::runtime_error("Console doesn't take virtual terminal sequences");
+		}
+		CONSOLE_SCREEN_BUFFER_INFO csbi;
+		if (::GetConsoleScreenBufferInfo(mOutputHandle, &csbi) == 0) {
+			throw std::runtime_error("Couldn't load screen buffer info");
+		}
+		mSize.X = csbi.srWindow.Right - csbi.srWindow.Left + 1;
+		mSize.Y = mWindowRows = csbi.srWindow.Bottom - csbi.srWindow.Top + 1;
+		mDefaultAttributes = csbi.wAttributes;
+
+		CHAR_INFO blank;
+		blank.Char.UnicodeChar = L' ';
+		blank.Attributes = mDefaultAttributes;
+		mBackCells.assign(mSize.X * mSize.Y, blank);
+		mFrontCells.assign(mSize.X * mWindowRows, blank);
+
+		// The alternate screen, cleared to what the front grid says is on it,
+		// without a cursor
+		mOutput = L"\x1b[?1049h\x1b[?25l";
+		AppendAttributes(mDefaultAttributes);
+		mOutput += L"\x1b[2J";
+		Write(mOutput);
+	}
+
+	VirtualTerminal::~VirtualTerminal() {
+		// Back to the main screen as it was
+		const std::wstring restore = L"\x1b[0m\x1b[?25h\x1b[?1049l";
+		unsigned long charsWritten;
+		::WriteConsoleW(mOutputHandle, restore.c_str(), restore.length(), &charsWritten, NULL);
+		::SetConsoleMode(mOutputHandle, mOriginalMode);
+		::CloseHandle(mOutputHandle);
+	}
+
+	COORD VirtualTerminal::GetSize() const {
+		return mSize;
+	}
+
+	void VirtualTerminal::Resize(short rows) {
+		if (rows <= mSize.Y) {
+			return;
+		}
+		CHAR_INFO blank;
+		blank.Char.UnicodeChar = L' ';
+		blank.Attributes = mDefaultAttributes;
+		mBackCells.resize(mSize.X * rows, blank);
+		mSize.Y = rows;
+	}
+
+	unsigned short VirtualTerminal::GetDefaultAttributes() const {
+		return mDefaultAttributes;
+	}
+
+	void VirtualTerminal::Clear(unsigned short attributes) {
+		for (auto& cell : mBackCells) {
+			cell.Char.UnicodeChar = L' ';
+			cell.Attributes = attributes;
+		}
+	}
+
+	void VirtualTerminal::WriteText(COORD position, const wchar_t* text, std::size_t length) {
+		if (position.Y < 0 || position.Y >= mSize.Y) {
+			return;
+		}
+		for (std::size_t i = 0; i < length && position.X + i < std::size_t(mSize.X); ++i) {
+			GetCell(short(position.X + i), position.Y).Char.UnicodeChar = text[i];
+		}
+	}
+
+	void VirtualTerminal::SetAttributes(const SMALL_RECT& region, unsigned short attributes) {
+		auto bottom = std::min(region.Bottom, short(mSize.Y - 1));
+		auto right = std::min(region.Right, short(mSize.X - 1));
+		for (auto row = std::max(region.Top, short(0)); row <= bottom; ++row) {
+			for (auto column = std::max(region.Left, short(0)); column <= right; ++column) {
+				GetCell(column, row).Attributes = attributes;
+			}
+		}
+	}
+
+	void VirtualTerminal::ScrollTo(short top, short bottom) {
+		if (bottom >= mWindowTop + mWindowRows) {
+			mWindowTop = bottom - mWindowRows + 1;
+		}
+		if (top < mWindowTop) {
+			mWindowTop = top;
+		}
+		mWindowTop = std::max(short(0), std::min(mWindowTop, short(mSize.Y - mWindowRows)));
+	}
+
+	void VirtualTerminal::Flush() {
+		mOutput.clear();
+		// Unknown until the first cell goes out
+		short cursorColumn = -1, cursorRow = -1;
+		auto attributes = -1;
+		for (short row = 0; row < mWindowRows; ++row) {
+			for (short column = 0; column < mSize.X; ++column) {
+				auto& back = GetCell(column, mWindowTop + row);
+				auto& front = mFrontCells[row * mSize.X + column];
+				if (back.Char.UnicodeChar == front.Char.UnicodeChar && back.Attributes == front.Attributes) {
+					continue;
+				}
+				if (column != cursorColumn || row != cursorRow) {
+					AppendCursorPosition(column, row);
+				}
+				if (back.Attributes != attributes) {
+					AppendAttributes(back.Attributes);
+					attributes = back.Attributes;
+				}
+				mOutput += back.Char.UnicodeChar;
+				front = back;
+				cursorColumn = column + 1;
+				cursorRow = row;
+			}
+		}
+		if (!mOutput.empty()) {
+			Write(mOutput);
+		}
+	}
+
+	unsigned long VirtualTerminal::GetCallCount() const {
+		return mCallCount;
+	}
+
+	CHAR_INFO& VirtualTerminal::GetCell(short column, short row) {
+		return mBackCells[row * mSize.X + column];
+	}
+
+	void VirtualTerminal::AppendCursorPosition(short column, short row) {
+		mOutput += L"\x1b[" + std::to_wstring(row + 1) + L';' + std::to_wstring(column + 1) + L'H';
+	}
+
+	void VirtualTerminal::AppendAttributes(unsigned short attributes) {
+		auto foreground = attributes & 0x0f, background = (attributes >> 4) & 0x0f;
+		auto foregroundCode = ((foreground & FOREGROUND_INTENSITY) ? 90 : 30) + ToAnsiColor(foreground);
+		auto backgroundCode = ((background & FOREGROUND_INTENSITY) ? 100 : 40) + ToAnsiColor(background);
+		mOutput += L"\x1b[" + std::to_wstring(foregroundCode) + L';' + std::to_wstring(backgroundCode) + L'm';
+	}
+
+	void VirtualTerminal::Write(const std::wstring& text) {
+		unsigned long charsWritten;
+		for (std::size_t offset = 0; offset < text.length(); offset += charsWritten) {
+			++mCallCount;
+			if (!::WriteConsoleW(mOutputHandle, text.c_str() + offset, text.length() - offset, &charsWritten, NULL)) {
+				throw std::runtime_error("Couldn't write to terminal");
+			}
+		}
+	}
+
+	unsigned short VirtualTerminal::ToAnsiColor(unsigned short color) {
+		return ((color & FOREGROUND_RED) ? 1 : 0)
+			| ((color & FOREGROUND_GREEN) ? 2 : 0)
+			| ((color & FOREGROUND_BLUE) ? 4 : 0);
+	}
+
+	RecordingTerminal::RecordingTerminal(short columns, short rows) :
+		mWindowRows(rows),
+		mWindowTop(0),
+		mDirty({ 0, 0, -1, -1 }),
+		mClearedAttributes(kDefaultAttributes),
+		mContentRows(0),
+		mHasPendingScroll(false),
+		mScrollTop(0),
+		mScrollBottom(0),
+		mCellsWritten(0),
+		mCallCount(0) {
+		mSize.X = columns;
+		mSize.Y = rows;
+		CHAR_INFO blank;
+		blank.Char.UnicodeChar = L' ';
+		blank.Attributes = kDefaultAttributes;
+		mBackCells.assign(columns * rows, blank);
+		mFrontCells = mBackCells;
+	}
+
+	COORD RecordingTerminal::GetSize() const {
+		return mSize;
+	}
+
+	void RecordingTerminal::Resize(short rows) {
+		if (rows <= mSize.Y) {
+			return;
+		}
+		++mCallCount;
+		CHAR_INFO blank;
+		blank.Char.UnicodeChar = L' ';
+		blank.Attributes = kDefaultAttributes;
+		mBackCells.resize(mSize.X * rows, blank);
+		mFrontCells.resize(mSize.X * rows, blank);
+		mSize.Y = rows;
+	}
+
+	unsigned short RecordingTerminal::GetDefaultAttributes() const {
+		return kDefaultAttributes;
+	}
+
+	void RecordingTerminal::Clear(unsigned short attributes) {
+		for (auto& cell : mBackCells) {
+			cell.Char.UnicodeChar = L' ';
+			cell.Attributes = attributes;
+		}
+		if (attributes == mClearedAttributes) {
+			if (mContentRows > 0) {
+				MarkDirty({ 0, 0, short(mSize.X - 1), short(mContentRows - 1) });
+			}
+		} else {
+			// Filled by the console, characters then attributes
+			mCallCount += 2;
+			mFrontCells = mBackCells;
+			mClearedAttributes = attributes;
+			mDirty = { 0, 0, -1, -1 };
+		}
+		mContentRows = 0;
+		Log(TerminalEvent::Clear, { 0, 0, short(mSize.X - 1), short(mSize.Y - 1) }, std::wstring(), attributes);
+	}
+
+	void RecordingTerminal::WriteText(COORD position, const wchar_t* text, std::size_t length) {
+		if (position.Y < 0 || position.Y >= mSize.Y || position.X < 0 || position.X >= mSize.X || length == 0) {
+			return;
+		}
+		length = std::min(length, std::size_t(mSize.X - position.X));
+		auto row = mBackCells.begin() + position.Y * mSize.X;
+		short left = mSize.X, right = -1;
+		for (std::size_t i = 0; i < length; ++i) {
+			auto& cell = row[position.X + i];
+			if (cell.Char.UnicodeChar != text[i]) {
+				cell.Char.UnicodeChar = text[i];
+				left = std::min(left, short(position.X + i));
+				right = short(position.X + i);
+			}
+		}
+		if (left <= right) {
+			MarkDirty({ left, position.Y, right, position.Y });
+		}
+		Log(TerminalEvent::Text, { position.X, position.Y, short(position.X + length - 1), position.Y }, std::wstring(text, length), 0);
+	}
+
+	void RecordingTerminal::SetAttributes(const SMALL_RECT& region, unsigned short attributes) {
+		// The log records the cells actually painted, not the region asked for
+		SMALL_RECT clipped = {
+			std::max(region.Left, short(0)),
+			std::max(region.Top, short(0)),
+			std::min(region.Right, short(mSize.X - 1)),
+			std::min(region.Bottom, short(mSize.Y - 1))
+		};
+		if (clipped.Left > clipped.Right || clipped.Top > clipped.Bottom) {
+			return;
+		}
+		for (auto row = clipped.Top; row <= clipped.Bottom; ++row) {
+			short changedLeft = mSize.X, changedRight = -1;
+			for (auto column = clipped.Left; column <= clipped.Right; ++column) {
+				auto& cell = mBackCells[row * mSize.X + column];
+				if (cell.Attributes != attributes) {
+					cell.Attributes = attributes;
+					changedLeft = std::min(changedLeft, column);
+					changedRight = column;
+				}
+			}
+			if (changedLeft <= changedRight) {
+				MarkDirty({ changedLeft, row, changedRight, row });
+			}
+		}
+		Log(TerminalEvent::Attributes, clipped, std::wstring(), attributes);
+	}
+
+	void RecordingTerminal::ScrollTo(short top, short bottom) {
+		mHasPendingScroll = true;
+		mScrollTop = top;
+		mScrollBottom = bottom;
+		Log(TerminalEvent::Scroll, { 0, top, short(mSize.X - 1), bottom }, std::wstring(), 0);
+	}
+
+	void RecordingTerminal::Flush() {
+		unsigned long cellsWritten = 0;
+		if (mDirty.Top <= mDirty.Bottom) {
+			// Split as the console terminal splits its blits
+			short width = mDirty.Right - mDirty.Left + 1;
+			auto rowsPerBlit = std::max(short(1), short(ConsoleTerminal::kMaxBlitCells / width));
+			for (auto top = mDirty.Top; top <= mDirty.Bottom; top += rowsPerBlit) {
+				++mCallCount;
+			}
+			for (auto row = mDirty.Top; row <= mDirty.Bottom; ++row) {
+				auto begin = row * mSize.X + mDirty.Left;
+				std::copy(mBackCells.begin() + begin, mBackCells.begin() + begin + width, mFrontCells.begin() + begin);
+			}
+			cellsWritten = static_cast<unsigned long>(width) * (mDirty.Bottom - mDirty.Top + 1);
+			mContentRows = std::max(mContentRows, short(mDirty.Bottom + 1));
+			mDirty = { 0, 0, -1, -1 };
+		}
+		if (mHasPendingScroll) {
+			mHasPendingScroll = false;
+			ScrollWindow();
+		}
+		mCellsWritten += cellsWritten;
+		Log(TerminalEvent::Flush, { 0, mWindowTop, short(mSize.X - 1), short(mWindowTop + mWindowRows - 1) }, std::wstring(), 0);
+		mLog.back().cellsWritten = cellsWritten;
+	}
+
+	unsigned long RecordingTerminal::GetCallCount() const {
+		return mCallCount;
+	}
+
+	const std::vector<TerminalEvent>& RecordingTerminal::GetLog() const {
+		return mLog;
+	}
+
+	void RecordingTerminal::ClearLog() {
+		mLog.clear();
+	}
+
+	unsigned long RecordingTerminal::GetCellsWritten() const {
+		return mCellsWritten;
+	}
+
+	std::wstring RecordingTerminal::GetWindowRow(short row) const {
+		std::wstring text;
+		auto begin = mFrontCells.begin() + (mWindowTop + row) * mSize.X;
+		for (auto cell = begin; cell != begin + mSize.X; ++cell) {
+			text += cell->Char.UnicodeChar;
+		}
+		return text;
+	}
+
+	void RecordingTerminal::ScrollWindow() {
+		// The console terminal asks where the window is on every scroll
+		++mCallCount;
+		short offset = 0;
+		if (mScrollBottom >= mWindowTop + mWindowRows) {
+			offset = mScrollBottom - (mWindowTop + mWindowRows - 1);
+		}
+		if (mScrollTop < mWindowTop + offset) {
+			offset = mScrollTop - mWindowTop;
+		}
+		offset = std::max(short(-mWindowTop), std::min(offset, short(mSize.Y - mWindowRows - mWindowTop)));
+		if (offset == 0) {
+			return;
+		}
+		++mCallCount;
+		mWindowTop += offset;
+	}
+
+	void RecordingTerminal::MarkDirty(const SMALL_RECT& region) {
+		if (mDirty.Top > mDirty.Bottom) {
+			mDirty = region;
+			return;
+		}
+		mDirty.Left = std::min(mDirty.Left, region.Left);
+		mDirty.Top = std::min(mDirty.Top, region.Top);
+		mDirty.Right = std::max(mDirty.Right, region.Right);
+		mDirty.Bottom = std::max(mDirty.Bottom, region.Bottom);
+	}
+
+	void RecordingTerminal::Log(TerminalEvent::Kind kind, const SMALL_RECT& region, const std::wstring& text, unsigned short attributes) {
+		TerminalEvent event = { kind, region, text, attributes, 0 };
+		mLog.push_back(event);
+	}
+} // namespace hackernewscmd
\ No newline at end of file
@@ -0,0 +1,212 @@
+/**
+ * @file terminal.h
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <Windows.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+namespace hackernewscmd {
+	enum class TerminalType {
+		Console, // Win32 console calls
+		Virtual // VT escape sequences
+	};
+
+	/**
+	 * Where Interact draws. A canvas of character cells with console
+	 * attributes, as wide as the window and as tall as what's drawn on it,
+	 * of which the window shows a part.
+	 * Drawing may be held back until Flush.
+	 * Implementations throw std::runtime_error when the output fails.
+	 */
+	class Terminal {
+	public:
+		virtual ~Terminal() {};
+		virtual COORD GetSize() const = 0;
+		// The canvas only ever grows
+		virtual void Resize(short rows) = 0;
+		virtual unsigned short GetDefaultAttributes() const = 0;
+
+		// Blanks the whole canvas
+		virtual void Clear(unsigned short attributes) = 0;
+		virtual void WriteText(COORD, const wchar_t*, std::size_t) = 0;
+		virtual void SetAttributes(const SMALL_RECT&, unsigned short) = 0;
+		// Scrolls the window as little as it takes to show the rows
+		virtual void ScrollTo(short top, short bottom) = 0;
+		virtual void Flush() = 0;
+		// Calls made to the console so far, to gauge what drawing costs
+		virtual unsigned long GetCallCount() const = 0;
+	};
+
+	/**
+	 * Draws into a screen buffer of its own through the Win32 console API.
+	 * Drawing is composed in a copy of the buffer's cells in memory, which
+	 * is what the console shows once flushed, so the cells can be changed
+	 * without reading them back. Flushing copies the rectangle around the
+	 * cells that changed across in one call, and scrolls the window only
+	 * if the rows asked for are out of view.
+	 */
+	class ConsoleTerminal : public Terminal {
+	public:
+		ConsoleTerminal();
+		~ConsoleTerminal();
+		ConsoleTerminal(const ConsoleTerminal&) = delete;
+		ConsoleTerminal& operator=(const ConsoleTerminal&) = delete;
+
+		COORD GetSize() const override;
+		void Resize(short) override;
+		unsigned short GetDefaultAttributes() const override;
+		void Clear(unsigned short) override;
+		void WriteText(COORD, const wchar_t*, std::size_t) override;
+		void SetAttributes(const SMALL_RECT&, unsigned short) override;
+		void ScrollTo(short, short) override;
+		void Flush() override;
+		unsigned long GetCallCount() const override;
+
+		// A block of cells the console copies in one go, well within the
+		// memory it sets aside for a call
+		static const short kMaxBlitCells = 8192;
+
+	private:
+		HANDLE mOutputHandle;
+		HANDLE mOriginalOutputHandle;
+		COORD mBufferSize;
+		unsigned short mDefaultAttributes;
+		std::vector<CHAR_INFO> mCells; // Row by row
+		SMALL_RECT mDirty; // Empty when its top is below its bottom
+		unsigned short mClearedAttributes;
+		short mContentRows; // Below these, the buffer is blank since the last clear
+		bool mHasPendingScroll;
+		short mScrollTop, mScrollBottom;
+		unsigned long mCallCount;
+
+		// Moves the window to the pending rows, if they're out of view
+		void ScrollWindow();
+		void MarkDirty(const SMALL_RECT&);
+	};
+
+	/**
+	 * Draws into a back grid of cells in memory. Flushing compares the part
+	 * the window shows against a front grid of what's on screen, and writes
+	 * escape sequences for the cells that changed only, in one go, moving
+	 * the cursor and changing colours no more than it has to. Runs on the
+	 * alternate screen of any console or terminal emulator that takes VT
+	 * sequences, and is far lighter on a remote session.
+	 */
+	class VirtualTerminal : public Terminal {
+	public:
+		VirtualTerminal();
+		~VirtualTerminal();
+		VirtualTerminal(const VirtualTerminal&) = delete;
+		VirtualTerminal& operator=(const VirtualTerminal&) = delete;
+
+		COORD GetSize() const override;
+		void Resize(short) override;
+		unsigned short GetDefaultAttributes() const override;
+		void Clear(unsigned short) override;
+		void WriteText(COORD, const wchar_t*, std::size_t) override;
+		void SetAttributes(const SMALL_RECT&, unsigned short) override;
+		void ScrollTo(short, short) override;
+		void Flush() override;
+		unsigned long GetCallCount() const override;
+
+	private:
+		HANDLE mOutputHandle;
+		unsigned long mOriginalMode;
+		COORD mSize; // Of the canvas
+		short mWindowRows;
+		short mWindowTop; // First canvas row in the window
+		unsigned short mDefaultAttributes;
+		std::vector<CHAR_INFO> mBackCells; // The canvas, row by row
+		std::vector<CHAR_INFO> mFrontCells; // The window, as last flushed
+		std::wstring mOutput;
+		unsigned long mCallCount;
+
+		CHAR_INFO& GetCell(short column, short row);
+		void AppendCursorPosition(short column, short row);
+		void AppendAttributes(unsigned short);
+		void Write(const std::wstring&);
+
+		// The console's colour bits are in the opposite order to ANSI's
+		static unsigned short ToAnsiColor(unsigned short);
+	};
+
+	/**
+	 * A primitive drawn on a recording terminal
+	 */
+	struct TerminalEvent {
+		enum Kind { Clear, Text, Attributes, Scroll, Flush } kind;
+		SMALL_RECT region; // The cells drawn on, or the rows scrolled to
+		std::wstring text; // For Text
+		unsigned short attributes; // For Clear and Attributes
+		unsigned long cellsWritten; // For Flush, the cells copied to the console
+	};
+
+	/**
+	 * Draws nowhere, logging every primitive instead, so that what drawing
+	 * costs can be measured and inspected without a console. Tracks the
+	 * dirty rectangle, blanking and scrolling the way the console terminal
+	 * does, so that its counts are the calls that terminal would make and
+	 * the cells it would copy across.
+	 */
+	class RecordingTerminal : public Terminal {
+	public:
+		RecordingTerminal(short columns, short rows);
+
+		COORD GetSize() const override;
+		void Resize(short) override;
+		unsigned short GetDefaultAttributes() const override;
+		void Clear(unsigned short) override;
+		void WriteText(COORD, const wchar_t*, std::size_t) override;
+		void SetAttributes(const SMALL_RECT&, unsigned short) override;
+		void ScrollTo(short, short) override;
+		void Flush() override;
+		unsigned long GetCallCount() const override;
+
+		const std::vector<TerminalEvent>& GetLog() const;
+		void ClearLog();
+		unsigned long GetCellsWritten() const;
+		// A row of the window, as of the last flush
+		std::wstring GetWindowRow(short) const;
+
+	private:
+		COORD mSize; // Of the canvas
+		short mWindowRows;
+		short mWindowTop; // First canvas row in the window
+		std::vector<CHAR_INFO> mBackCells; // The canvas, row by row
+		std::vector<CHAR_INFO> mFrontCells; // The canvas, as last flushed
+		SMALL_RECT mDirty; // Empty when its top is below its bottom
+		unsigned short mClearedAttributes;
+		short mContentRows; // Below these, the canvas is blank since the last clear
+		bool mHasPendingScroll;
+		short mScrollTop, mScrollBottom;
+		std::vector<TerminalEvent> mLog;
+		unsigned long mCellsWritten;
+		unsigned long mCallCount;
+
+		void ScrollWindow();
+		void MarkDirty(const SMALL_RECT&);
+		void Log(TerminalEvent::Kind, const SMALL_RECT&, const std::wstring&, unsigned short);
+
+		static const unsigned short kDefaultAttributes = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE;
+	};
+} // namespace hackernewscmd
\ No newline at end of file
@@ -0,0 +1,215 @@
+/**
+ * @file top_stories_subscription.cpp
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "top_stories_subscription.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include "rapidjson/document.h"
+
+#undef min
+
+
+namespace hackernewscmd {
+	static const std::size_t kMaxEntries = 1000; // Firebase lists 500
+
+	// Null deletes the entry
+	static void SetEntry(std::vector<StoryId>& entries, const std::size_t index, const rapidjson::Value& value) {
+		if (index >= kMaxEntries) {
+			return;
+		}
+		if (index >= entries.size()) {
+			entries.resize(index + 1);
+		}
+		entries[index] = value.IsUint64() ? value.GetUint64() : 0;
+	}
+
+	static bool TryParseIndex(const std::string& key, std::size_t& index) {
+		if (key.empty() || key.size() > 9 || key.find_first_not_of("0123456789") != std::string::npos) {
+			return false;
+		}
+		index = std::strtoul(key.c_str(), nullptr, 10);
+		return true;
+	}
+
+	// Applies a put or patch at a path, which is either the list or one
+	// entry of it. Firebase sends the list as an object, keyed by index, when
+	// it has holes.
+	static bool TryApply(std::vector<StoryId>& entries, const std::string& type, const std::string& path, const rapidjson::Value& data) {
+		std::size_t index = 0;
+		if (path != "/") {
+			if (path[0] != '/' || !TryParseIndex(path.substr(1), index)) {
+				return false;
+			}
+			SetEntry(entries, index, data);
+			return true;
+		}
+
+		if (type == "put") {
+			entries.clear();
+		}
+		if (data.IsArray()) {
+			for (rapidjson::SizeType i = 0; i < data.Size(); ++i) {
+				SetEntry(entries, i, data[i]);
+			}
+		} else if (data.IsObject()) {
+			for (auto member = data.MemberBegin(); member != data.MemberEnd(); ++member) {
+				if (TryParseIndex(std::string(member->name.GetString(), member->name.GetStringLength()), index)) {
+					SetEntry(entries, index, member->value);
+				}
+			}
+		} else if (!data.IsNull()) {
+			return false;
+		}
+		return true;
+	}
+
+	const TopStoriesSubscription::Clock::duration TopStoriesSubscription::kReconnectBase = std::chrono::seconds(1);
+	const TopStoriesSubscription::Clock::duration TopStoriesSubscription::kReconnectCap = std::chrono::seconds(60);
+
+	TopStoriesSubscription::TopStoriesSubscription(Transport& transport, const std::string& path, const std::function<void(std::vector<StoryId>)>& onUpdate) :
+		mTransport(transport),
+		mPath(path),
+		mOnUpdate(onUpdate),
+		mRetryMs(0),
+		mRandom(std::random_device()()),
+		mIsStopping(false),
+		mUpdateCount(0),
+		mReconnectCount(0) {
+		mThread = std::thread(&TopStoriesSubscription::ThreadCallback, this);
+	}
+
+	TopStoriesSubscription::~TopStoriesSubscription() {
+		{
+			std::lock_guard<std::mutex> lock(mStreamMutex);
+			mIsStopping = true;
+			if (mStream != nullptr) {
+				mStream->Abort();
+			}
+		}
+		mStopCV.notify_all();
+		if (mThread.joinable()) {
+			mThread.join();
+		}
+	}
+
+	SubscriptionStats TopStoriesSubscription::GetStats() const {
+		return { mUpdateCount.load(), mReconnectCount.load() };
+	}
+
+	void TopStoriesSubscription::ThreadCallback() {
+		unsigned failures = 0;
+		for (;;) {
+			bool isHealthy = false;
+			try {
+				isHealthy = Stream();
+			} catch (const std::runtime_error&) {
+				// Reconnected below, like a stream that ended
+			}
+			failures = isHealthy ? 1 : failures + 1;
+
+			std::unique_lock<std::mutex> lock(mStreamMutex);
+			if (mStopCV.wait_for(lock, GetReconnectDelay(failures), [this] { return mIsStopping; })) {
+				return;
+			}
+			++mReconnectCount;
+		}
+	}
+
+	bool TopStoriesSubscription::Stream() {
+		auto headers = std::string("Accept: text/event-stream\r\n");
+		if (!mLastEventId.empty()) {
+			headers += "Last-Event-ID: " + mLastEventId + "\r\n";
+		}
+		std::shared_ptr<ResponseStream> stream = mTransport.OpenStream(mPath, headers);
+		{
+			std::lock_guard<std::mutex> lock(mStreamMutex);
+			if (mIsStopping) {
+				return false;
+			}
+			mStream = stream;
+		}
+
+		bool hasEvents = false;
+		EventStreamParser parser([this, &hasEvents](const ServerSentEvent& event) {
+			hasEvents = true;
+			OnEvent(event);
+		});
+		char buffer[kReadChunkSize];
+		try {
+			std::size_t length;
+			while ((length = stream->Read(buffer, sizeof(buffer))) != 0) {
+				parser.Parse(buffer, length);
+			}
+		} catch (const std::runtime_error&) {
+			// Cancelled by the server, or garbled, so back off as if it failed
+			hasEvents = false;
+		}
+		mLastEventId = parser.GetLastEventId();
+		mRetryMs = parser.GetRetryMs() != 0 ? parser.GetRetryMs() : mRetryMs;
+
+		std::lock_guard<std::mutex> lock(mStreamMutex);
+		mStream = nullptr;
+		return hasEvents;
+	}
+
+	void TopStoriesSubscription::OnEvent(const ServerSentEvent& event) {
+		if (event.type == "cancel" || event.type == "auth_revoked") {
+			throw std::runtime_error("Stream closed by the server: " + event.type);
+		}
+		if (event.type != "put" && event.type != "patch") {
+			return; // Such as keep-alive
+		}
+
+		rapidjson::Document document;
+		document.Parse(event.data.c_str());
+		if (document.HasParseError() || !document.IsObject()) {
+			return;
+		}
+		auto path = document.FindMember("path");
+		auto data = document.FindMember("data");
+		if (path == document.MemberEnd() || !path->value.IsString() || data == document.MemberEnd()
+			|| !TryApply(mEntries, event.type, path->value.GetString(), data->value)) {
+			return;
+		}
+
+		std::vector<StoryId> topStories;
+		topStories.reserve(mEntries.size());
+		std::copy_if(mEntries.begin(), mEntries.end(), std::back_inserter(topStories), [](StoryId id) { return id != 0; });
+		if (topStories == mLastUpdate) {
+			return; // Such as the list put again on reconnecting, unchanged
+		}
+		mLastUpdate = topStories;
+		++mUpdateCount;
+		mOnUpdate(std::move(topStories));
+	}
+
+	TopStoriesSubscription::Clock::duration TopStoriesSubscription::GetReconnectDelay(const unsigned failures) {
+		// Full jitter, starting from the delay the server asked for. That's
+		// capped before it's doubled, as a large one would overflow.
+		auto base = mRetryMs != 0 ? Clock::duration(std::chrono::milliseconds(mRetryMs)) : kReconnectBase;
+		base = std::min(base, kReconnectCap);
+		auto factor = Clock::rep(1) << std::min(failures - 1, 16u);
+		auto ceiling = base > kReconnectCap / factor ? kReconnectCap : base * factor;
+		std::uniform_int_distribution<Clock::rep> distribution(0, ceiling.count());
+		return Clock::duration(distribution(mRandom));
+	}
+} // namespace hackernewscmd
\ No newline at end of file
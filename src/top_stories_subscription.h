@@ -0,0 +1,92 @@
+/**
+ * @file top_stories_subscription.h
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "event_stream_parser.h"
+#include "story.h"
+#include "transport.h"
+
+
+namespace hackernewscmd {
+	struct SubscriptionStats {
+		unsigned long updates; // Changes to the list handed out
+		unsigned long reconnects;
+	};
+
+	/**
+	 * Keeps the top stories list up to date over one long lived streaming
+	 * request (Firebase's text/event-stream), instead of downloading it again.
+	 * The first event on every connection puts the whole list, later ones
+	 * patch entries of it; the handler is called, on the subscription's own
+	 * thread, with the list after every change. A dropped stream is reopened
+	 * after a jittered exponential backoff, and resumes from the list put on
+	 * reconnecting, so only what changed in between is handed out.
+	 */
+	class TopStoriesSubscription {
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		TopStoriesSubscription(Transport&, const std::string&, const std::function<void(std::vector<StoryId>)>&);
+		// Waits for the stream to be closed
+		~TopStoriesSubscription();
+		TopStoriesSubscription(const TopStoriesSubscription&) = delete;
+		TopStoriesSubscription& operator=(const TopStoriesSubscription&) = delete;
+
+		SubscriptionStats GetStats() const;
+
+	private:
+		Transport& mTransport;
+		const std::string mPath;
+		const std::function<void(std::vector<StoryId>)> mOnUpdate;
+		// Only touched by the subscription thread
+		std::vector<StoryId> mEntries; // Zero where an entry has been deleted
+		std::vector<StoryId> mLastUpdate;
+		std::string mLastEventId;
+		unsigned long mRetryMs;
+		std::minstd_rand mRandom; // Seeded once, draws in the same clock tick still differ
+
+		std::shared_ptr<ResponseStream> mStream; // Guarded by mStreamMutex
+		bool mIsStopping; // Guarded by mStreamMutex
+		std::mutex mStreamMutex;
+		std::condition_variable mStopCV;
+		std::atomic<unsigned long> mUpdateCount;
+		std::atomic<unsigned long> mReconnectCount;
+		std::thread mThread;
+		static const std::size_t kReadChunkSize = 4096;
+		static const Clock::duration kReconnectBase;
+		static const Clock::duration kReconnectCap;
+
+		void ThreadCallback();
+		// Returns true if the stream delivered an event before it ended
+		bool Stream();
+		void OnEvent(const ServerSentEvent&);
+		Clock::duration GetReconnectDelay(const unsigned);
+	}; // class TopStoriesSubscription
+} // namespace hackernewscmd
\ No newline at end of file
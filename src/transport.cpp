@@ -0,0 +1,524 @@
+/**
+ * @file transport.cpp
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "transport.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include "event_loop.h"
+
+#undef min
+
+
+namespace hackernewscmd {
+	Endpoint Endpoint::Parse(const std::string& url) {
+		static const std::string kHttp = "http://", kHttps = "https://";
+		Endpoint endpoint;
+		auto rest = url;
+		endpoint.isSecure = true;
+		if (rest.compare(0, kHttp.size(), kHttp) == 0) {
+			endpoint.isSecure = false;
+			rest.erase(0, kHttp.size());
+		} else if (rest.compare(0, kHttps.size(), kHttps) == 0) {
+			rest.erase(0, kHttps.size());
+		}
+		rest = rest.substr(0, rest.find('/'));
+
+		auto colon = rest.find(':');
+		endpoint.host = rest.substr(0, colon);
+		endpoint.port = endpoint.isSecure ? INTERNET_DEFAULT_HTTPS_PORT : INTERNET_DEFAULT_HTTP_PORT;
+		if (colon != std::string::npos) {
+			endpoint.port = static_cast<INTERNET_PORT>(std::stoul(rest.substr(colon + 1)));
+		}
+		if (endpoint.host.empty()) {
+			throw std::runtime_error("No host in " + url);
+		}
+		return endpoint;
+	}
+
+	std::string Endpoint::GetUrl() const {
+		return (isSecure ? "https://" : "http://") + host + ":" + std::to_string(port);
+	}
+
+	std::string Validators::ToRequestHeaders() const {
+		// Firebase only hands out an ETag when asked to
+		std::string headers = "X-Firebase-ETag: true\r\n";
+		if (!etag.empty()) {
+			headers += "If-None-Match: " + etag + "\r\n";
+		}
+		if (!lastModified.empty()) {
+			headers += "If-Modified-Since: " + lastModified + "\r\n";
+		}
+		return headers;
+	}
+
+	std::string QueryHttpHeader(HINTERNET resultHandle, unsigned long header) {
+		char buff[256];
+		unsigned long size = sizeof(buff);
+		if (!::HttpQueryInfoA(resultHandle, header, buff, &size, NULL)) {
+			return std::string();
+		}
+		return std::string(buff, size);
+	}
+
+	void LimitConnectionsPerServer() {
+		static std::once_flag once;
+		std::call_once(once, []() {
+			unsigned long maxConnections = kMaxConnectionsPerServer;
+			::InternetSetOptionA(NULL, INTERNET_OPTION_MAX_CONNS_PER_SERVER, &maxConnections, sizeof(maxConnections));
+		});
+	}
+
+	LiveTransport::LiveTransport(const Endpoint& endpoint) :
+		mEndpoint(endpoint),
+		mInternetHandle(NULL),
+		mConnectHandle(NULL),
+		mRequestCount(0),
+		mConnectionCount(0) {}
+
+	LiveTransport::~LiveTransport() {
+		if (mConnectHandle != NULL) {
+			::InternetCloseHandle(mConnectHandle);
+		}
+		if (mInternetHandle != NULL) {
+			::InternetCloseHandle(mInternetHandle);
+		}
+	}
+
+	void LiveTransport::Fetch(const std::string& path, std::vector<char>& body) {
+		HINTERNET resultHandle = SendRequest(path);
+		try {
+			ReadBody(resultHandle, body);
+		} catch (...) {
+			::InternetCloseHandle(resultHandle);
+			throw;
+		}
+		// The body has been read to the end, so closing the request hands the
+		// connection back to the pool instead of tearing it down
+		::InternetCloseHandle(resultHandle);
+	}
+
+	bool LiveTransport::FetchIfModified(const std::string& path, Validators& validators, std::vector<char>& body) {
+		auto headers = validators.ToRequestHeaders();
+		HINTERNET resultHandle = SendRequest(path, headers);
+
+		unsigned long status = 0, headerSize = sizeof(status);
+		::HttpQueryInfoA(resultHandle, HTTP_QUERY_STATUS_CODE | HTTP_QUERY_FLAG_NUMBER, &status, &headerSize, NULL);
+		if (status == 304) {
+			::InternetCloseHandle(resultHandle);
+			return false;
+		}
+		if (status != 200) {
+			// An error body must not be cached, nor its validators kept
+			::InternetCloseHandle(resultHandle);
+			throw std::runtime_error("Couldn't fetch " + path + ", status " + std::to_string(status));
+		}
+		validators.etag = QueryHttpHeader(resultHandle, HTTP_QUERY_ETAG);
+		validators.lastModified = QueryHttpHeader(resultHandle, HTTP_QUERY_LAST_MODIFIED);
+		try {
+			ReadBody(resultHandle, body);
+		} catch (...) {
+			::InternetCloseHandle(resultHandle);
+			throw;
+		}
+		::InternetCloseHandle(resultHandle);
+		return true;
+	}
+
+	void LiveTransport::ReadBody(HINTERNET resultHandle, std::vector<char>& body) {
+		// Size the buffer up front when the server tells us how much is coming,
+		// and read straight into it. The spare byte lets the final zero length
+		// read, and the caller's terminator, go through without reallocating.
+		unsigned long contentLength = 0, headerSize = sizeof(contentLength);
+		if (!::HttpQueryInfoA(resultHandle, HTTP_QUERY_CONTENT_LENGTH | HTTP_QUERY_FLAG_NUMBER, &contentLength, &headerSize, NULL)) {
+			contentLength = 0;
+		}
+		body.resize(contentLength != 0 ? contentLength + 1 : kReadChunkSize);
+
+		std::size_t length = 0;
+		unsigned long bytesRead = 0;
+		for (;;) {
+			if (length == body.size()) {
+				body.resize(body.size() + kReadChunkSize);
+			}
+			if (!::InternetReadFile(resultHandle, body.data() + length, body.size() - length, &bytesRead)) {
+				// A body cut short must not pass for the whole of it
+				throw std::runtime_error("Couldn't read response body");
+			}
+			if (bytesRead == 0) {
+				break;
+			}
+			length += bytesRead;
+		}
+		body.resize(length);
+	}
+
+	void LiveTransport::FetchStreaming(const std::string& path, const DataCallback& onData) {
+		HINTERNET resultHandle = SendRequest(path);
+		unsigned long bytesRead = 0;
+		char buff[kReadChunkSize];
+		try {
+			while (::InternetReadFile(resultHandle, buff, kReadChunkSize, &bytesRead) && bytesRead != 0) {
+				onData(buff, bytesRead);
+			}
+		} catch (...) {
+			::InternetCloseHandle(resultHandle);
+			throw;
+		}
+		::InternetCloseHandle(resultHandle);
+	}
+
+	std::unique_ptr<ResponseStream> LiveTransport::OpenStream(const std::string& path, const std::string& headers) {
+		// Quiet spells on a stream are normal, so it gets a receive timeout of
+		// its own rather than the one bounding fetch attempts
+		HINTERNET resultHandle = SendRequest(path, headers, kStreamReceiveTimeoutMs);
+
+		unsigned long status = 0, headerSize = sizeof(status);
+		::HttpQueryInfoA(resultHandle, HTTP_QUERY_STATUS_CODE | HTTP_QUERY_FLAG_NUMBER, &status, &headerSize, NULL);
+		if (status != 200) {
+			::InternetCloseHandle(resultHandle);
+			throw std::runtime_error("Couldn't stream " + path + ", status " + std::to_string(status));
+		}
+		return std::make_unique<LiveResponseStream>(resultHandle);
+	}
+
+	std::unique_ptr<FetchSession> LiveTransport::OpenFetchSession() {
+		return std::make_unique<EventLoop>(mEndpoint);
+	}
+
+	ConnectionStats LiveTransport::GetConnectionStats() const {
+		return { mRequestCount.load(), mConnectionCount.load() };
+	}
+
+	HINTERNET LiveTransport::GetInternetHandle() {
+		if (mInternetHandle == NULL) {
+			auto url = mEndpoint.GetUrl();
+			if (::InternetAttemptConnect(0) != ERROR_SUCCESS) {
+				throw std::runtime_error("Couldn't connect to internet");
+			}
+			if (::InternetCheckConnectionA(url.c_str(), FLAG_ICC_FORCE_CONNECTION, 0) != TRUE) {
+				throw std::runtime_error("Couldn't connect to " + url);
+			}
+			LimitConnectionsPerServer();
+			if ((mInternetHandle = ::InternetOpenA("hncmd", INTERNET_OPEN_TYPE_PRECONFIG, NULL, NULL, 0)) == NULL) {
+				throw std::runtime_error("Couldn't get internet handle");
+			}
+			// Bounds each attempt, the fetcher owns retries and the overall
+			// deadline
+			unsigned long timeout = kAttemptTimeoutMs;
+			::InternetSetOptionA(mInternetHandle, INTERNET_OPTION_CONNECT_TIMEOUT, &timeout, sizeof(timeout));
+			::InternetSetOptionA(mInternetHandle, INTERNET_OPTION_SEND_TIMEOUT, &timeout, sizeof(timeout));
+			::InternetSetOptionA(mInternetHandle, INTERNET_OPTION_RECEIVE_TIMEOUT, &timeout, sizeof(timeout));
+			::InternetSetStatusCallbackA(mInternetHandle, InternetStatusCallback);
+		}
+		return mInternetHandle;
+	}
+
+	HINTERNET LiveTransport::GetConnectHandle() {
+		std::lock_guard<std::mutex> lock(mConnectMutex);
+		if (mConnectHandle == NULL) {
+			// Every request made through this handle shares the session's pool
+			// of persistent connections to the host
+			if ((mConnectHandle = ::InternetConnectA(GetInternetHandle(), mEndpoint.host.c_str(), mEndpoint.port,
+				NULL, NULL, INTERNET_SERVICE_HTTP, 0, reinterpret_cast<DWORD_PTR>(this))) == NULL) {
+				throw std::runtime_error("Couldn't connect to " + mEndpoint.host);
+			}
+		}
+		return mConnectHandle;
+	}
+
+	HINTERNET LiveTransport::SendRequest(const std::string& path, const std::string& headers, unsigned long receiveTimeoutMs) {
+		const unsigned long flags = (mEndpoint.isSecure ? INTERNET_FLAG_SECURE : 0) | INTERNET_FLAG_KEEP_CONNECTION | INTERNET_FLAG_RELOAD;
+		HINTERNET resultHandle;
+		if ((resultHandle = ::HttpOpenRequestA(GetConnectHandle(), "GET", path.c_str(), NULL, NULL, NULL, flags, reinterpret_cast<DWORD_PTR>(this))) == NULL) {
+			throw std::runtime_error("Couldn't fetch " + path);
+		}
+		++mRequestCount;
+		if (receiveTimeoutMs != 0) {
+			::InternetSetOptionA(resultHandle, INTERNET_OPTION_RECEIVE_TIMEOUT, &receiveTimeoutMs, sizeof(receiveTimeoutMs));
+		}
+		if (::HttpSendRequestA(resultHandle, headers.empty() ? NULL : headers.c_str(), headers.length(), NULL, 0) != TRUE) {
+			::InternetCloseHandle(resultHandle);
+			throw std::runtime_error("Couldn't fetch " + path);
+		}
+		return resultHandle;
+	}
+
+	void CALLBACK LiveTransport::InternetStatusCallback(HINTERNET, DWORD_PTR context, DWORD status, void*, DWORD) {
+		if (status == INTERNET_STATUS_CONNECTED_TO_SERVER && context != 0) {
+			++reinterpret_cast<LiveTransport*>(context)->mConnectionCount;
+		}
+	}
+
+	LiveResponseStream::LiveResponseStream(HINTERNET requestHandle) :
+		mRequestHandle(requestHandle) {}
+
+	LiveResponseStream::~LiveResponseStream() {
+		Abort();
+	}
+
+	std::size_t LiveResponseStream::Read(char* buffer, std::size_t size) {
+		HINTERNET requestHandle = mRequestHandle;
+		if (requestHandle == NULL) {
+			return 0;
+		}
+		// A synchronous read waits to fill the whole buffer, so wait for
+		// whatever has arrived and read only that much
+		unsigned long available = 0, bytesRead = 0;
+		if (!::InternetQueryDataAvailable(requestHandle, &available, 0, 0) || available == 0) {
+			return 0;
+		}
+		auto toRead = static_cast<unsigned long>(std::min(static_cast<std::size_t>(available), size));
+		if (!::InternetReadFile(requestHandle, buffer, toRead, &bytesRead)) {
+			return 0;
+		}
+		return bytesRead;
+	}
+
+	void LiveResponseStream::Abort() {
+		HINTERNET requestHandle = mRequestHandle.exchange(NULL);
+		if (requestHandle != NULL) {
+			::InternetCloseHandle(requestHandle);
+		}
+	}
+
+	/**
+	 * Passes fetches through to the session of the transport being recorded,
+	 * recording the bodies that come back
+	 */
+	class RecordingTransport::Session : public FetchSession {
+	public:
+		Session(RecordingTransport& transport) :
+			mTransport(transport),
+			mSession(transport.mTransport.OpenFetchSession()) {}
+
+		void Submit(const std::string& path, const Validators& validators, Clock::duration delay, FetchCompletion completion) override {
+			auto transport = &mTransport;
+			mSession->Submit(path, validators, delay, [transport, path, completion](FetchResult result, std::vector<char>&& body, const Validators& validators) {
+				if (result == FetchResult::Modified) {
+					transport->Record(path, body.data(), body.size());
+				}
+				completion(result, std::move(body), validators);
+			});
+		}
+
+		void Stop() override {
+			mSession->Stop();
+		}
+
+		ConnectionStats GetConnectionStats() const override {
+			return mSession->GetConnectionStats();
+		}
+
+	private:
+		RecordingTransport& mTransport;
+		const std::unique_ptr<FetchSession> mSession;
+	};
+
+	RecordingTransport::RecordingTransport(Transport& transport, const std::string& corpusPath) :
+		mTransport(transport),
+		mCorpus(corpusPath, std::ofstream::binary | std::ofstream::app) {
+		if (!mCorpus) {
+			throw std::runtime_error("Couldn't open corpus " + corpusPath);
+		}
+	}
+
+	void RecordingTransport::Fetch(const std::string& path, std::vector<char>& body) {
+		mTransport.Fetch(path, body);
+		Record(path, body.data(), body.size());
+	}
+
+	void RecordingTransport::FetchStreaming(const std::string& path, const DataCallback& onData) {
+		std::vector<char> body;
+		mTransport.FetchStreaming(path, [&body, &onData](const char* data, std::size_t length) {
+			body.insert(body.end(), data, data + length);
+			onData(data, length);
+		});
+		Record(path, body.data(), body.size());
+	}
+
+	void RecordingTransport::Record(const std::string& path, const char* body, std::size_t length) {
+		std::lock_guard<std::mutex> lock(mCorpusMutex);
+		auto pathLength = static_cast<std::uint32_t>(path.size());
+		auto bodyLength = static_cast<std::uint32_t>(length);
+		mCorpus.write(reinterpret_cast<const char*>(&pathLength), sizeof(pathLength));
+		mCorpus.write(path.data(), pathLength);
+		mCorpus.write(reinterpret_cast<const char*>(&bodyLength), sizeof(bodyLength));
+		mCorpus.write(body, bodyLength);
+		mCorpus.flush();
+	}
+
+	ConnectionStats RecordingTransport::GetConnectionStats() const {
+		return mTransport.GetConnectionStats();
+	}
+
+	std::unique_ptr<ResponseStream> RecordingTransport::OpenStream(const std::string& path, const std::string& headers) {
+		return mTransport.OpenStream(path, headers);
+	}
+
+	std::unique_ptr<FetchSession> RecordingTransport::OpenFetchSession() {
+		return std::make_unique<Session>(*this);
+	}
+
+	/**
+	 * Serves fetches from the corpus on a thread of its own, each once its
+	 * delay and the replay latency have passed
+	 */
+	class ReplayTransport::Session : public FetchSession {
+	public:
+		Session(const ReplayTransport& transport) :
+			mTransport(transport),
+			mIsStopping(false) {
+			mThread = std::thread(&Session::Run, this);
+		}
+
+		~Session() {
+			Stop();
+		}
+
+		void Submit(const std::string& path, const Validators&, Clock::duration delay, FetchCompletion completion) override {
+			// Every body is recorded whole, so there's nothing to validate
+			Fetch fetch{ Clock::now() + delay + std::chrono::milliseconds(mTransport.mLatencyMs), path, std::move(completion) };
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (mIsStopping) {
+				return;
+			}
+			mDelayed.push_back(std::move(fetch));
+			std::push_heap(mDelayed.begin(), mDelayed.end(), IsLater);
+			mCondition.notify_one();
+		}
+
+		void Stop() override {
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mIsStopping = true;
+				mDelayed.clear();
+				mCondition.notify_one();
+			}
+			if (mThread.joinable()) {
+				mThread.join();
+			}
+		}
+
+	private:
+		struct Fetch {
+			Clock::time_point due;
+			std::string path;
+			FetchCompletion completion;
+		};
+
+		const ReplayTransport& mTransport;
+		std::vector<Fetch> mDelayed; // Heap, earliest due first
+		bool mIsStopping;
+		std::mutex mMutex;
+		std::condition_variable mCondition;
+		std::thread mThread;
+
+		void Run() {
+			std::unique_lock<std::mutex> lock(mMutex);
+			while (!mIsStopping) {
+				if (mDelayed.empty()) {
+					mCondition.wait(lock);
+					continue;
+				}
+				if (mDelayed.front().due > Clock::now()) {
+					mCondition.wait_until(lock, mDelayed.front().due);
+					continue;
+				}
+				std::pop_heap(mDelayed.begin(), mDelayed.end(), IsLater);
+				auto fetch = std::move(mDelayed.back());
+				mDelayed.pop_back();
+
+				// Completions submit retries and further fetches
+				lock.unlock();
+				auto recorded = mTransport.Find(fetch.path);
+				if (recorded == nullptr) {
+					fetch.completion(FetchResult::Failed, std::vector<char>(), Validators());
+				} else {
+					fetch.completion(FetchResult::Modified, std::vector<char>(recorded->begin(), recorded->end()), Validators());
+				}
+				lock.lock();
+			}
+		}
+
+		static bool IsLater(const Fetch& a, const Fetch& b) {
+			return a.due > b.due;
+		}
+	};
+
+	ReplayTransport::ReplayTransport(const std::string& corpusPath, unsigned long latencyMs) :
+		mLatencyMs(latencyMs) {
+		std::ifstream corpus(corpusPath, std::ifstream::binary);
+		if (!corpus) {
+			throw std::runtime_error("Couldn't open corpus " + corpusPath);
+		}
+
+		std::uint32_t pathLength, bodyLength;
+		while (corpus.read(reinterpret_cast<char*>(&pathLength), sizeof(pathLength))) {
+			std::string path(pathLength, '\0');
+			corpus.read(&path[0], pathLength);
+			corpus.read(reinterpret_cast<char*>(&bodyLength), sizeof(bodyLength));
+			std::vector<char> body(bodyLength);
+			if (bodyLength != 0) {
+				corpus.read(body.data(), bodyLength);
+			}
+			if (!corpus) {
+				throw std::runtime_error("Truncated corpus " + corpusPath);
+			}
+			// A later recording of the same path supersedes an earlier one
+			mCorpus[path] = std::move(body);
+		}
+	}
+
+	void ReplayTransport::Fetch(const std::string& path, std::vector<char>& body) {
+		const auto& recorded = Lookup(path);
+		body.assign(recorded.begin(), recorded.end());
+	}
+
+	void ReplayTransport::FetchStreaming(const std::string& path, const DataCallback& onData) {
+		const auto& recorded = Lookup(path);
+		for (std::size_t offset = 0; offset < recorded.size(); offset += kChunkSize) {
+			onData(recorded.data() + offset, std::min(recorded.size() - offset, static_cast<std::size_t>(kChunkSize)));
+		}
+	}
+
+	std::unique_ptr<FetchSession> ReplayTransport::OpenFetchSession() {
+		return std::make_unique<Session>(*this);
+	}
+
+	const std::vector<char>& ReplayTransport::Lookup(const std::string& path) const {
+		if (mLatencyMs != 0) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(mLatencyMs));
+		}
+		auto recorded = Find(path);
+		if (recorded == nullptr) {
+			throw std::runtime_error("No recorded response for " + path);
+		}
+		return *recorded;
+	}
+
+	const std::vector<char>* ReplayTransport::Find(const std::string& path) const {
+		auto it = mCorpus.find(path);
+		return it == mCorpus.end() ? nullptr : &it->second;
+	}
+} // namespace hackernewscmd
\ No newline at end of file
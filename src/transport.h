@@ -0,0 +1,276 @@
+/**
+ * @file transport.h
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <Windows.h>
+#include <Wininet.h>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#pragma comment(lib, "Wininet")
+
+
+namespace hackernewscmd {
+	/**
+	 * Counters for the keep-alive connection pool.
+	 * Requests minus connections is the number of requests that were served
+	 * over an already established connection.
+	 */
+	struct ConnectionStats {
+		unsigned long requests;
+		unsigned long connections;
+	};
+
+	/**
+	 * Where the API is served from. A local mirror can stand in for the real
+	 * host, over plain HTTP.
+	 */
+	struct Endpoint {
+		std::string host;
+		INTERNET_PORT port;
+		bool isSecure;
+
+		// Takes [http[s]://]host[:port], HTTPS being the default
+		static Endpoint Parse(const std::string&);
+		std::string GetUrl() const;
+	};
+
+	using DataCallback = std::function<void(const char*, std::size_t)>;
+
+	/**
+	 * HTTP cache validators of a previously fetched body
+	 */
+	struct Validators {
+		std::string etag;
+		std::string lastModified;
+
+		// Headers for a conditional request, which also ask Firebase for an
+		// ETag to validate with next time
+		std::string ToRequestHeaders() const;
+	};
+
+	// Empty when the response has no such header
+	std::string QueryHttpHeader(HINTERNET, unsigned long);
+
+	// Enough for the thread pool's highest concurrency limit, WinINet queues
+	// whatever the event loop has in flight beyond it
+	const unsigned long kMaxConnectionsPerServer = 64;
+
+	// WinINet bounds the keep-alive pool for each server process wide, so
+	// every session sets it from the one constant, before opening
+	void LimitConnectionsPerServer();
+
+	/**
+	 * The body of a response that stays open, read as it arrives
+	 */
+	class ResponseStream {
+	public:
+		virtual ~ResponseStream() {};
+		// Blocks until some of the body arrives. Returns 0 once the body has
+		// ended, broken off or been aborted.
+		virtual std::size_t Read(char*, std::size_t) = 0;
+		// Makes a blocked read return, from any thread
+		virtual void Abort() = 0;
+	};
+
+	enum class FetchResult {
+		Modified,
+		NotModified,
+		Failed
+	};
+
+	// Called on the session's thread. The validators are only meaningful for
+	// a modified body.
+	using FetchCompletion = std::function<void(FetchResult, std::vector<char>&&, const Validators&)>;
+
+	/**
+	 * Fetches asynchronously, with many requests in flight at once and no
+	 * thread waiting on each. Destroying it abandons whatever is in flight.
+	 */
+	class FetchSession {
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		virtual ~FetchSession() {};
+		// Conditional fetch, started once the delay has passed. May be called
+		// from any thread.
+		virtual void Submit(const std::string&, const Validators&, Clock::duration, FetchCompletion) = 0;
+		// Abandons whatever is in flight, without completing it, and returns
+		// once no completion is running
+		virtual void Stop() = 0;
+		virtual ConnectionStats GetConnectionStats() const { return { 0, 0 }; }
+	};
+
+	/**
+	 * Fetches the raw UTF-8 body of a path on the API host, either into a
+	 * caller owned buffer whose capacity is reused across fetches, or
+	 * streamed to a callback as it arrives.
+	 * Implementations throw std::runtime_error when a body can't be had.
+	 */
+	class Transport {
+	public:
+		virtual ~Transport() {};
+		virtual void Fetch(const std::string&, std::vector<char>&) = 0;
+		virtual void FetchStreaming(const std::string&, const DataCallback&) = 0;
+		virtual ConnectionStats GetConnectionStats() const { return { 0, 0 }; }
+
+		// Conditional fetch. Returns false, leaving the buffer alone, when the
+		// body hasn't changed since the validators were handed out; otherwise
+		// fills the buffer and updates the validators.
+		virtual bool FetchIfModified(const std::string& path, Validators&, std::vector<char>& body) {
+			Fetch(path, body);
+			return true;
+		}
+
+		// Sends a request with the given extra headers and hands back its body
+		// to read for as long as the server keeps it open
+		virtual std::unique_ptr<ResponseStream> OpenStream(const std::string& path, const std::string&) {
+			throw std::runtime_error("Can't stream " + path);
+		}
+
+		// A session fetching through this transport without a thread per
+		// request
+		virtual std::unique_ptr<FetchSession> OpenFetchSession() {
+			throw std::runtime_error("Can't fetch asynchronously");
+		}
+	};
+
+	/**
+	 * Talks to the API host over WinINet, keeping a bounded pool of
+	 * keep-alive connections.
+	 */
+	class LiveTransport : public Transport {
+	public:
+		LiveTransport(const Endpoint&);
+		~LiveTransport();
+		LiveTransport(const LiveTransport&) = delete;
+		LiveTransport& operator=(const LiveTransport&) = delete;
+
+		void Fetch(const std::string&, std::vector<char>&) override;
+		void FetchStreaming(const std::string&, const DataCallback&) override;
+		ConnectionStats GetConnectionStats() const override;
+		bool FetchIfModified(const std::string&, Validators&, std::vector<char>&) override;
+		std::unique_ptr<ResponseStream> OpenStream(const std::string&, const std::string&) override;
+		// An event loop of its own, on the same endpoint
+		std::unique_ptr<FetchSession> OpenFetchSession() override;
+
+	private:
+		const Endpoint mEndpoint;
+		HINTERNET mInternetHandle;
+		HINTERNET mConnectHandle;
+		std::mutex mConnectMutex;
+		std::atomic<unsigned long> mRequestCount;
+		std::atomic<unsigned long> mConnectionCount;
+		static const std::size_t kReadChunkSize = 4096;
+		static const unsigned long kAttemptTimeoutMs = 5000;
+		// Firebase sends a keep-alive event every 30 seconds on a quiet stream
+		static const unsigned long kStreamReceiveTimeoutMs = 75000;
+
+		HINTERNET GetInternetHandle();
+		HINTERNET GetConnectHandle();
+		// A zero receive timeout keeps the session's
+		HINTERNET SendRequest(const std::string&, const std::string& = std::string(), unsigned long = 0);
+		void ReadBody(HINTERNET, std::vector<char>&);
+		static void CALLBACK InternetStatusCallback(HINTERNET, DWORD_PTR, DWORD, void*, DWORD);
+	};
+
+	/**
+	 * Owns a WinINet request whose body is read as it trickles in.
+	 * Aborting closes the request, which fails a read blocked on it.
+	 */
+	class LiveResponseStream : public ResponseStream {
+	public:
+		LiveResponseStream(HINTERNET);
+		~LiveResponseStream();
+		LiveResponseStream(const LiveResponseStream&) = delete;
+		LiveResponseStream& operator=(const LiveResponseStream&) = delete;
+
+		std::size_t Read(char*, std::size_t) override;
+		void Abort() override;
+
+	private:
+		std::atomic<HINTERNET> mRequestHandle;
+	};
+
+	/**
+	 * Passes requests through to another transport, appending every
+	 * path and body pair to a corpus file that ReplayTransport can serve.
+	 *
+	 * Corpus records are laid out as
+	 * [path length][path][body length][body], lengths being 32 bit.
+	 */
+	class RecordingTransport : public Transport {
+	public:
+		RecordingTransport(Transport&, const std::string&);
+
+		void Fetch(const std::string&, std::vector<char>&) override;
+		void FetchStreaming(const std::string&, const DataCallback&) override;
+		ConnectionStats GetConnectionStats() const override;
+		// Streams aren't recorded, they have no single body to replay
+		std::unique_ptr<ResponseStream> OpenStream(const std::string&, const std::string&) override;
+		// Records the bodies of the other transport's session as they arrive
+		std::unique_ptr<FetchSession> OpenFetchSession() override;
+
+	private:
+		class Session;
+
+		Transport& mTransport;
+		std::ofstream mCorpus;
+		std::mutex mCorpusMutex;
+
+		void Record(const std::string&, const char*, std::size_t);
+	};
+
+	/**
+	 * Serves bodies from a corpus written by RecordingTransport, without
+	 * touching the network. Every fetch is delayed by a fixed latency so
+	 * that page load timings can be reproduced. Streamed bodies are handed
+	 * out in read sized chunks. Asynchronous fetches are delayed alike, on a
+	 * thread that serves each as it falls due rather than one after another.
+	 */
+	class ReplayTransport : public Transport {
+	public:
+		ReplayTransport(const std::string&, unsigned long);
+
+		void Fetch(const std::string&, std::vector<char>&) override;
+		void FetchStreaming(const std::string&, const DataCallback&) override;
+		std::unique_ptr<FetchSession> OpenFetchSession() override;
+
+	private:
+		class Session;
+
+		std::unordered_map<std::string, std::vector<char>> mCorpus;
+		const unsigned long mLatencyMs;
+		static const std::size_t kChunkSize = 4096;
+
+		const std::vector<char>& Lookup(const std::string&) const;
+		// Without the latency, nothing when the path wasn't recorded
+		const std::vector<char>* Find(const std::string&) const;
+	};
+} // namespace hackernewscmd
\ No newline at end of file
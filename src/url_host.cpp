@@ -0,0 +1,88 @@
+/**
+ * @file url_host.cpp
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "url_host.h"
+
+
+namespace hackernewscmd {
+	static bool IsAlpha(char c) {
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+	}
+
+	static bool IsSchemeChar(char c) {
+		return IsAlpha(c) || (c >= '0' && c <= '9') || c == '+' || c == '-' || c == '.';
+	}
+
+	static bool IsAuthorityEnd(char c) {
+		return c == '/' || c == '?' || c == '#' || c == '\\';
+	}
+
+	bool TryGetUrlHost(const char* url, std::size_t length, const char*& host, std::size_t& hostLength) {
+		const char* it = url;
+		const char* end = url + length;
+
+		// Scheme, which protocol relative URLs go without
+		if (it != end && IsAlpha(*it)) {
+			const char* scheme = it;
+			while (scheme != end && IsSchemeChar(*scheme)) {
+				++scheme;
+			}
+			if (scheme != end && *scheme == ':') {
+				it = scheme + 1;
+			}
+		}
+		if (end - it < 2 || it[0] != '/' || it[1] != '/') {
+			return false;
+		}
+		it += 2;
+
+		// The authority runs up to the path, and the host is what's left of
+		// it after the userinfo
+		const char* authorityEnd = it;
+		const char* hostStart = it;
+		while (authorityEnd != end && !IsAuthorityEnd(*authorityEnd)) {
+			if (*authorityEnd == '@') {
+				hostStart = authorityEnd + 1;
+			}
+			++authorityEnd;
+		}
+
+		const char* hostEnd = hostStart;
+		if (hostEnd != authorityEnd && *hostEnd == '[') {
+			while (hostEnd != authorityEnd && *hostEnd != ']') {
+				++hostEnd;
+			}
+			if (hostEnd == authorityEnd) {
+				return false;
+			}
+			++hostEnd;
+		} else {
+			while (hostEnd != authorityEnd && *hostEnd != ':') {
+				++hostEnd;
+			}
+		}
+		if (hostEnd == hostStart) {
+			return false;
+		}
+
+		host = hostStart;
+		hostLength = hostEnd - hostStart;
+		return true;
+	}
+} // namespace hackernewscmd
\ No newline at end of file
@@ -0,0 +1,33 @@
+/**
+ * @file url_host.h
+ *
+ * Copyright 2015 Mayank Kumar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+
+
+namespace hackernewscmd {
+	/**
+	 * Finds the host of an absolute URL in place, without allocating or
+	 * decoding anything: [scheme:]//[userinfo@]host[:port][/path][?query][#fragment]
+	 * Bracketed IPv6 hosts keep their brackets.
+	 * Returns false, leaving the outputs alone, when there's no host.
+	 */
+	bool TryGetUrlHost(const char*, std::size_t, const char*& host, std::size_t& hostLength);
+} // namespace hackernewscmd
\ No newline at end of file